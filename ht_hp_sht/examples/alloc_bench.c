@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bf.h"
+#include "hp_file.h"
+#include "ht_table.h"
+#include "sht_table.h"
+
+#define HEAP_FILE "alloc_heap.db"
+#define HASH_FILE "alloc_hash.db"
+#define INDEX_FILE "alloc_index.db"
+#define RECORDS 20000
+#define WARMUP 1000         // the first calls may allocate once, e.g. the stdout buffer
+#define LOOKUPS 5000
+#define HASH_BUCKETS 200
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 8192      // every file fits, the pool is not what we measure
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+/* Every heap allocation of the process goes through these and is counted */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+static long allocations = 0;
+
+void* malloc(size_t size) {
+  __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+  __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+  __libc_free(ptr);
+}
+
+Record records[RECORDS];
+int block_ids[RECORDS];
+
+void report(const char* name, long calls, long allocs) {
+  fprintf(stderr, "%-28s %10ld %12ld %14.3f\n", name, calls, allocs, (double)allocs / calls);
+}
+
+int main() {
+  srand(12569874);
+  for (int i = 0; i < RECORDS; ++i) {
+    records[i] = randomRecord();
+  }
+  HP_RemoveFile(HEAP_FILE);
+  remove(HASH_FILE);
+  remove(INDEX_FILE);
+
+  /* HT_GetAllEntries and SHT_SecondaryGetAllEntries print every match, keep them off the report */
+  freopen("/dev/null", "w", stdout);
+
+  CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+  HP_CreateFile(HEAP_FILE);
+  HT_CreateFile(HASH_FILE, HASH_BUCKETS);
+  SHT_CreateSecondaryIndex(INDEX_FILE, HASH_BUCKETS, HASH_FILE);
+  HP_info* hp_info = HP_OpenFile(HEAP_FILE);
+  HT_info* ht_info = HT_OpenFile(HASH_FILE);
+  SHT_info* sht_info = SHT_OpenSecondaryIndex(INDEX_FILE);
+
+  for (int i = 0; i < WARMUP; ++i) {
+    HP_InsertEntry(hp_info, records[i]);
+    block_ids[i] = HT_InsertEntry(ht_info, records[i]);
+    SHT_SecondaryInsertEntry(sht_info, records[i], block_ids[i]);
+    HT_GetAllEntries(ht_info, &records[i].id);
+    SHT_SecondaryGetAllEntries(ht_info, sht_info, records[i].name);
+  }
+
+  fprintf(stderr, "heap allocations per call, %d records, %d buckets, %d frames\n",
+          RECORDS, HASH_BUCKETS, POOL_SIZE);
+  fprintf(stderr, "%-28s %10s %12s %14s\n", "call", "calls", "allocations", "per call");
+
+  long before = allocations;
+  for (int i = WARMUP; i < RECORDS; ++i) {
+    HP_InsertEntry(hp_info, records[i]);
+  }
+  report("HP_InsertEntry", RECORDS - WARMUP, allocations - before);
+
+  before = allocations;
+  for (int i = WARMUP; i < RECORDS; ++i) {
+    block_ids[i] = HT_InsertEntry(ht_info, records[i]);
+  }
+  report("HT_InsertEntry", RECORDS - WARMUP, allocations - before);
+
+  before = allocations;
+  for (int i = WARMUP; i < RECORDS; ++i) {
+    SHT_SecondaryInsertEntry(sht_info, records[i], block_ids[i]);
+  }
+  report("SHT_SecondaryInsertEntry", RECORDS - WARMUP, allocations - before);
+
+  before = allocations;
+  for (int i = 0; i < LOOKUPS; ++i) {
+    HT_GetAllEntries(ht_info, &records[rand() % RECORDS].id);
+  }
+  report("HT_GetAllEntries", LOOKUPS, allocations - before);
+
+  before = allocations;
+  for (int i = 0; i < LOOKUPS; ++i) {
+    SHT_SecondaryGetAllEntries(ht_info, sht_info, records[rand() % RECORDS].name);
+  }
+  report("SHT_SecondaryGetAllEntries", LOOKUPS, allocations - before);
+
+  SHT_CloseSecondaryIndex(sht_info);
+  HT_CloseFile(ht_info);
+  HP_CloseFile(hp_info);
+  CALL_OR_DIE(BF_Close());
+  HP_RemoveFile(HEAP_FILE);
+  remove(HASH_FILE);
+  remove(INDEX_FILE);
+}
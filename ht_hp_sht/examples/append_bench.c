@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bf.h"
+#include "hp_file.h"
+
+#define HEAP_FILE "append_bench.db"
+#define RECORDS 1000000
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 24576     // the whole file fits, the runs measure the inserts and not the disk
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+Record records[RECORDS];
+
+double elapsed(struct timespec* start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void report(const char* name, double seconds, long gets, double base) {
+  fprintf(stderr, "%-16s %10.3f %14.0f %14.3f %10.2fx\n", name, seconds, RECORDS / seconds,
+          (double)gets / RECORDS, seconds / base);
+}
+
+/* Insert every record with HP_InsertEntry or with the append cursor */
+double run_inserts(int append, long* gets) {
+  HP_RemoveFile(HEAP_FILE);
+  CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+  HP_CreateFile(HEAP_FILE);
+  HP_info* info = HP_OpenFile(HEAP_FILE);
+  BF_ResetStats();
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (append) {
+    HP_BeginAppend(info);
+    for (int i = 0; i < RECORDS; ++i) {
+      HP_Append(info, &records[i]);
+    }
+    HP_EndAppend(info);
+  } else {
+    for (int i = 0; i < RECORDS; ++i) {
+      HP_InsertEntry(info, records[i]);
+    }
+  }
+  double seconds = elapsed(&start);
+
+  BF_Stats stats;
+  BF_GetGlobalStats(&stats);
+  *gets = stats.gets;
+  HP_CloseFile(info);
+  CALL_OR_DIE(BF_Close());
+  return seconds;
+}
+
+int main() {
+  srand(12569874);
+  for (int i = 0; i < RECORDS; ++i) {
+    records[i] = randomRecord();
+  }
+
+  /* The floor: copy the records into blocks of the same layout, nothing else */
+  int per_block = (BLOCK_SIZE - sizeof(HP_block_info)) / sizeof(Record);
+  char* blocks = malloc((size_t)(RECORDS / per_block + 1) * BLOCK_SIZE);
+  memset(blocks, 0, (size_t)(RECORDS / per_block + 1) * BLOCK_SIZE);
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < RECORDS; ++i) {
+    memcpy(blocks + (size_t)(i / per_block) * BLOCK_SIZE + (i % per_block) * sizeof(Record),
+           &records[i], sizeof(Record));
+  }
+  double base = elapsed(&start);
+
+  fprintf(stderr, "%d records into %d-byte blocks, %d frames\n", RECORDS, BLOCK_SIZE, POOL_SIZE);
+  fprintf(stderr, "%-16s %10s %14s %14s %11s\n",
+          "method", "seconds", "records/sec", "gets/record", "vs memcpy");
+  report("memcpy", base, 0, base);
+
+  long gets;
+  double seconds = run_inserts(0, &gets);
+  report("HP_InsertEntry", seconds, gets, base);
+  seconds = run_inserts(1, &gets);
+  report("HP_Append", seconds, gets, base);
+
+  free(blocks);
+  HP_RemoveFile(HEAP_FILE);
+}
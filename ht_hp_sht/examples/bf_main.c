@@ -28,7 +28,7 @@ int main() {
   και unpin για να μην γεμίσει η ενδιάμεση μνήμη. Μπορούμε να ανοίξουμε
   το αρχείο block_example.db για να δούμε τα περιεχόμενά του.
   */
-  CALL_OR_DIE(BF_Init(LRU));
+  CALL_OR_DIE(BF_Init(LRU, BF_DEFAULT_BLOCK_SIZE, BF_DEFAULT_BUFFER_SIZE));
   CALL_OR_DIE(BF_CreateFile("block_example.db"))
   CALL_OR_DIE(BF_OpenFile("block_example.db", &fd1));
 
@@ -51,7 +51,7 @@ int main() {
   /* Δεύτερο Μέρος: χρήση της βιβλιοθήκης για block η οποία διαβάζει
   από κάθε block τα δύο πρώτα records.*/
 
-  CALL_OR_DIE(BF_Init(LRU));
+  CALL_OR_DIE(BF_Init(LRU, BF_DEFAULT_BLOCK_SIZE, BF_DEFAULT_BUFFER_SIZE));
   CALL_OR_DIE(BF_OpenFile("block_example.db", &fd1));
   int blocks_num;
   CALL_OR_DIE(BF_GetBlockCounter(fd1, &blocks_num));
@@ -67,9 +67,47 @@ int main() {
     CALL_OR_DIE(BF_UnpinBlock(block));
   }
 
-  BF_Block_Destroy(&block);
   CALL_OR_DIE(BF_CloseFile(fd1));
   CALL_OR_DIE(BF_Close());
 
+
+
+
+  /* Τρίτο Μέρος: με BF_OPEN_MMAP δύο BF_Block δείχνουν στο ίδιο block της
+  απεικόνισης. Το καθένα αλλάζει μια διαφορετική εγγραφή και γίνεται dirty,
+  και μετά το κλείσιμο πρέπει να έχουν γραφτεί στον δίσκο και οι δύο.*/
+
+  CALL_OR_DIE(BF_Init(LRU, BF_DEFAULT_BLOCK_SIZE, BF_DEFAULT_BUFFER_SIZE));
+  CALL_OR_DIE(BF_OpenFileMode("block_example.db", &fd1, BF_OPEN_MMAP));
+  BF_Block *other;
+  BF_Block_Init(&other);
+  Record first = randomRecord();
+  Record second = randomRecord();
+
+  CALL_OR_DIE(BF_GetBlock(fd1, 0, block));
+  CALL_OR_DIE(BF_GetBlock(fd1, 0, other));
+  ((Record *)BF_Block_GetData(block))[0] = first;
+  BF_Block_SetDirty(block);
+  ((Record *)BF_Block_GetData(other))[1] = second;
+  BF_Block_SetDirty(other);
+  CALL_OR_DIE(BF_UnpinBlock(block));
+  CALL_OR_DIE(BF_UnpinBlock(other));
+  CALL_OR_DIE(BF_CloseFile(fd1));
+  CALL_OR_DIE(BF_Close());
+
+  CALL_OR_DIE(BF_Init(LRU, BF_DEFAULT_BLOCK_SIZE, BF_DEFAULT_BUFFER_SIZE));
+  CALL_OR_DIE(BF_OpenFile("block_example.db", &fd1));
+  CALL_OR_DIE(BF_GetBlock(fd1, 0, block));
+  Record* rec = (Record *)BF_Block_GetData(block);
+  int kept = memcmp(&rec[0], &first, sizeof(Record)) == 0
+          && memcmp(&rec[1], &second, sizeof(Record)) == 0;
+  CALL_OR_DIE(BF_UnpinBlock(block));
+  printf("mapped block edited through two handles: %s\n", kept ? "both records kept" : "a record was lost");
+
+  BF_Block_Destroy(&other);
+  BF_Block_Destroy(&block);
+  CALL_OR_DIE(BF_CloseFile(fd1));
+  CALL_OR_DIE(BF_Close());
+  return kept ? 0 : 1;
 }
 
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bf.h"
+#include "ht_table.h"
+
+#define HT_FILE "bucket_bench.db"
+#define RECORDS 1000000
+#define BLOCK_SIZE 512      // the smallest block, where block 0 alone held about 60 buckets
+#define POOL_SIZE 1048576   // 512 MB, the files fit and the runs count gets and not reads
+#define LOOKUPS 2000
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+double elapsed(struct timespec* start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main() {
+  /* The lookups print their matches, keep them off the report */
+  freopen("/dev/null", "w", stdout);
+
+  fprintf(stderr, "%d records in %d-byte blocks, %d lookups of existing ids\n", RECORDS, BLOCK_SIZE,
+          LOOKUPS);
+  fprintf(stderr, "%10s %10s %10s %12s %14s %14s\n", "buckets", "dir blocks", "blocks",
+          "insert sec", "gets/lookup", "us/lookup");
+
+  for (int buckets = 100; buckets <= 1000000; buckets *= 100) {
+    CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+    remove(HT_FILE);
+    if (HT_CreateFile(HT_FILE, buckets) != 0) {
+      fprintf(stderr, "HT_CreateFile(%d) failed\n", buckets);
+      exit(1);
+    }
+    HT_info* info = HT_OpenFile(HT_FILE);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    srand(12569874);
+    for (int i = 0; i < RECORDS; ++i) {
+      Record record = randomRecord();
+      record.id = i;
+      HT_InsertEntry(info, record);
+    }
+    double insert = elapsed(&start);
+
+    srand(4242);
+    BF_ResetStats();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < LOOKUPS; ++i) {
+      int id = rand() % RECORDS;
+      HT_GetAllEntries(info, &id);
+    }
+    double seconds = elapsed(&start);
+    BF_Stats stats;
+    BF_GetGlobalStats(&stats);
+    int blocks;
+    BF_GetBlockCounter(info->fileDesc, &blocks);
+    fprintf(stderr, "%10d %10d %10d %12.2f %14.2f %14.2f\n", buckets, info->dirBlocks, blocks, insert,
+            (double)stats.gets / LOOKUPS, seconds * 1e6 / LOOKUPS);
+
+    HT_CloseFile(info);
+    CALL_OR_DIE(BF_Close());
+  }
+  remove(HT_FILE);
+}
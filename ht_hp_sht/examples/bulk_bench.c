@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bf.h"
+#include "hp_file.h"
+
+#define HEAP_FILE "bulk_bench.db"
+#define RECORDS 2000000
+#define BATCH 10000         // records handed to each HP_BulkInsert
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 4096      // 16 MB, about a tenth of the file, so blocks are written as the load goes
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+Record records[RECORDS];
+
+/* Load every record, one at a time or in batches, and close the file so that
+   the time includes writing it */
+void run_load(const char* name, int bulk, double* base) {
+  HP_RemoveFile(HEAP_FILE);
+  CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+  HP_CreateFile(HEAP_FILE);
+  BF_ResetStats();
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  HP_info* info = HP_OpenFile(HEAP_FILE);
+  if (bulk) {
+    for (int i = 0; i < RECORDS; i += BATCH) {
+      HP_BulkInsert(info, records + i, RECORDS - i < BATCH ? RECORDS - i : BATCH);
+    }
+  } else {
+    for (int i = 0; i < RECORDS; ++i) {
+      HP_InsertEntry(info, records[i]);
+    }
+  }
+  int last = info->last;
+  HP_CloseFile(info);
+  BF_Stats stats;
+  BF_GetGlobalStats(&stats);
+  CALL_OR_DIE(BF_Close());
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  if (*base == 0) {
+    *base = seconds;
+  }
+  fprintf(stderr, "%-16s %8d %10.3f %14.0f %10ld %10ld %10ld %9.2fx\n", name, last, seconds,
+          RECORDS / seconds, stats.gets, stats.reads, stats.io_calls, *base / seconds);
+}
+
+int main() {
+  srand(12569874);
+  for (int i = 0; i < RECORDS; ++i) {
+    records[i] = randomRecord();
+  }
+
+  fprintf(stderr, "%d records into %d-byte blocks, %d frames, batches of %d\n",
+          RECORDS, BLOCK_SIZE, POOL_SIZE, BATCH);
+  fprintf(stderr, "%-16s %8s %10s %14s %10s %10s %10s %10s\n",
+          "method", "blocks", "seconds", "records/sec", "gets", "reads", "io calls", "speedup");
+
+  double base = 0;
+  run_load("HP_InsertEntry", 0, &base);
+  run_load("HP_BulkInsert", 1, &base);
+
+  HP_RemoveFile(HEAP_FILE);
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bf.h"
+#include "hp_file.h"
+
+#define HEAP_FILE "direct_bench.db"
+#define HEAP_RECORDS 200000
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 1024      // about a quarter of the file
+#define GETS 40000
+#define PASSES 2            // the second pass shows what the page cache adds
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+const char* mode_names[] = {"buffered", "mmap", "direct"};
+
+/* Drop the blocks of the file from the page cache so that every mode starts cold */
+void drop_page_cache() {
+  int fd = open(HEAP_FILE, O_RDONLY);
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+/* Bytes of the file the kernel keeps in the page cache */
+long page_cache_bytes() {
+  int fd = open(HEAP_FILE, O_RDONLY);
+  struct stat st;
+  fstat(fd, &st);
+  long page = sysconf(_SC_PAGESIZE);
+  size_t pages = (st.st_size + page - 1) / page;
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  unsigned char* vec = malloc(pages);
+  long cached = 0;
+  if (map != MAP_FAILED && mincore(map, st.st_size, vec) == 0) {
+    for (size_t i = 0; i < pages; ++i) {
+      cached += vec[i] & 1;
+    }
+  }
+  free(vec);
+  munmap(map, st.st_size);
+  close(fd);
+  return cached * page;
+}
+
+int main() {
+  srand(12569874);
+  HP_RemoveFile(HEAP_FILE);
+  CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, 16384));
+  HP_CreateFile(HEAP_FILE);
+  HP_info* info = HP_OpenFile(HEAP_FILE);
+  for (int i = 0; i < HEAP_RECORDS; ++i) {
+    HP_InsertEntry(info, randomRecord());
+  }
+  HP_CloseFile(info);
+  CALL_OR_DIE(BF_Close());
+
+  fprintf(stderr, "%d random gets per pass over %d records, %d frames of %d bytes\n",
+          GETS, HEAP_RECORDS, POOL_SIZE, BLOCK_SIZE);
+  fprintf(stderr, "%-9s %5s %10s %10s %12s %16s\n",
+          "mode", "pass", "seconds", "reads", "pool MB", "page cache MB");
+
+  BF_OpenMode modes[] = {BF_OPEN_BUFFERED, BF_OPEN_DIRECT};
+  for (int m = 0; m < 2; ++m) {
+    drop_page_cache();
+    CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+    int fd;
+    BF_ErrorCode code = BF_OpenFileMode(HEAP_FILE, &fd, modes[m]);
+    if (code != BF_OK) {
+      fprintf(stderr, "%-9s cannot open the file: ", mode_names[modes[m]]);
+      BF_PrintError(code);
+      CALL_OR_DIE(BF_Close());
+      continue;
+    }
+    int blocks;
+    CALL_OR_DIE(BF_GetBlockCounter(fd, &blocks));
+
+    BF_Block* block;
+    BF_Block_Init(&block);
+    srand(4242);
+    for (int pass = 1; pass <= PASSES; ++pass) {
+      BF_ResetStats();
+      struct timespec start, end;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (int i = 0; i < GETS; ++i) {
+        CALL_OR_DIE(BF_GetBlock(fd, 1 + rand() % (blocks - 1), block));
+        CALL_OR_DIE(BF_UnpinBlock(block));
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      BF_Stats stats;
+      CALL_OR_DIE(BF_GetStats(fd, &stats));
+      double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+      fprintf(stderr, "%-9s %5d %10.3f %10ld %12.1f %16.1f\n",
+              mode_names[modes[m]], pass, seconds, stats.reads,
+              (double)POOL_SIZE * BLOCK_SIZE / (1 << 20),
+              (double)page_cache_bytes() / (1 << 20));
+    }
+    BF_Block_Destroy(&block);
+    CALL_OR_DIE(BF_CloseFile(fd));
+    CALL_OR_DIE(BF_Close());
+  }
+
+  HP_RemoveFile(HEAP_FILE);
+}
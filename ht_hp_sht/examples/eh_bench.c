@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bf.h"
+#include "ht_table.h"
+#include "eh_table.h"
+
+#define HT_FILE "eh_bench_ht.db"
+#define EH_FILE "eh_bench_eh.db"
+#define HASH_BUCKETS 400    // a fixed table sized for the small files
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 65536     // 256 MB, the files fit and the runs count gets and not reads
+#define LOOKUPS 2000
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+double elapsed(struct timespec* start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Point lookups of existing ids, the buffer pool gets and the time of each */
+void measure(const char* name, int records, int (*lookup)(void*, void*), void* info) {
+  srand(4242);
+  BF_ResetStats();
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < LOOKUPS; ++i) {
+    int id = rand() % records;
+    lookup(info, &id);
+  }
+  double seconds = elapsed(&start);
+  BF_Stats stats;
+  BF_GetGlobalStats(&stats);
+  fprintf(stderr, "%-6s %10d %14.2f %14.2f\n", name, records,
+          (double)stats.gets / LOOKUPS, seconds * 1e6 / LOOKUPS);
+}
+
+int ht_lookup(void* info, void* id) { return HT_GetAllEntries(info, id); }
+int eh_lookup(void* info, void* id) { return EH_GetAllEntries(info, id); }
+
+int main() {
+  /* The lookups print their matches, keep them off the report */
+  freopen("/dev/null", "w", stdout);
+
+  fprintf(stderr, "%d lookups of existing ids, HT with %d buckets against extendible hashing\n",
+          LOOKUPS, HASH_BUCKETS);
+  fprintf(stderr, "%-6s %10s %14s %14s\n", "file", "records", "gets/lookup", "us/lookup");
+
+  for (int records = 1000; records <= 1000000; records *= 10) {
+    CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+    remove(HT_FILE);
+    remove(EH_FILE);
+    HT_CreateFile(HT_FILE, HASH_BUCKETS);
+    EH_CreateFile(EH_FILE);
+    HT_info* ht = HT_OpenFile(HT_FILE);
+    EH_info* eh = EH_OpenFile(EH_FILE);
+    srand(12569874);
+    for (int i = 0; i < records; ++i) {
+      Record record = randomRecord();
+      record.id = i;
+      HT_InsertEntry(ht, record);
+      EH_InsertEntry(eh, record);
+    }
+
+    measure("HT", records, ht_lookup, ht);
+    measure("EH", records, eh_lookup, eh);
+
+    HT_CloseFile(ht);
+    EH_CloseFile(eh);
+    CALL_OR_DIE(BF_Close());
+  }
+  remove(HT_FILE);
+  remove(EH_FILE);
+}
@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bf.h"
+#include "eh_table.h"
+
+#define RECORDS_NUM 3000 // you can change it if you want
+#define FILE_NAME "data.db"
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+int main() {
+  BF_Init(LRU, BF_DEFAULT_BLOCK_SIZE, BF_DEFAULT_BUFFER_SIZE);
+
+  remove(FILE_NAME);
+  EH_CreateFile(FILE_NAME);
+  EH_info* info = EH_OpenFile(FILE_NAME);
+
+  Record record;
+  srand(12569874);
+  printf("Insert Entries\n");
+  for (int id = 0; id < RECORDS_NUM; ++id) {
+    record = randomRecord();
+    EH_InsertEntry(info, record);
+  }
+
+  printf("RUN PrintAllEntries\n");
+  int id = rand() % RECORDS_NUM;
+  EH_GetAllEntries(info, &id);
+
+  EH_HashStatistics(info);
+
+  EH_CloseFile(info);
+  BF_Close();
+}
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bf.h"
+#include "ht_table.h"
+#include "sht_table.h"
+
+#define HT_FILE "hash_bench.db"
+#define SHT_FILE "hash_bench_index.db"
+#define RECORDS 100000
+#define BUCKETS 1024        // a power of two, where the modulo keeps only the low bits of the key
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 65536     // 256 MB, the files fit and the runs count gets and not reads
+#define LOOKUPS 2000
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+const char* hash_names[] = {"modulo", "fibonacci", "wyhash"};
+
+double elapsed(struct timespec* start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Keys the way they come from real tables: sequential ids, ids that are
+   multiples of the number of buckets, and names that differ only in their
+   last characters */
+int key_id(int pattern, int i) { return pattern == 0 ? i : i * BUCKETS; }
+
+void key_name(char* name, int i) { snprintf(name, 15, "user%06d", i); }
+
+int main() {
+  /* The lookups print their matches, keep them off the report */
+  freopen("/dev/null", "w", stdout);
+
+  fprintf(stderr, "%d records, %d buckets, %d lookups of existing keys\n", RECORDS, BUCKETS, LOOKUPS);
+  fprintf(stderr, "%-6s %-12s %-10s %14s %14s %14s\n", "file", "keys", "hash", "us/insert",
+          "gets/lookup", "us/lookup");
+
+  const char* id_patterns[] = {"sequential", "strided"};
+  for (int pattern = 0; pattern < 2; ++pattern) {
+    for (HT_Hash function = HT_HASH_MODULO; function <= HT_HASH_WYHASH; ++function) {
+      CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+      remove(HT_FILE);
+      HT_CreateFileHash(HT_FILE, BUCKETS, HT_MODE_STATIC, function);
+      HT_info* info = HT_OpenFile(HT_FILE);
+
+      struct timespec start;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      srand(12569874);
+      for (int i = 0; i < RECORDS; ++i) {
+        Record record = randomRecord();
+        record.id = key_id(pattern, i);
+        HT_InsertEntry(info, record);
+      }
+      double insert = elapsed(&start);
+
+      srand(4242);
+      BF_ResetStats();
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (int i = 0; i < LOOKUPS; ++i) {
+        int id = key_id(pattern, rand() % RECORDS);
+        HT_GetAllEntries(info, &id);
+      }
+      double seconds = elapsed(&start);
+      BF_Stats stats;
+      BF_GetGlobalStats(&stats);
+      fprintf(stderr, "%-6s %-12s %-10s %14.2f %14.2f %14.2f\n", "HT", id_patterns[pattern],
+              hash_names[function], insert * 1e6 / RECORDS, (double)stats.gets / LOOKUPS,
+              seconds * 1e6 / LOOKUPS);
+
+      HT_CloseFile(info);
+      CALL_OR_DIE(BF_Close());
+    }
+  }
+
+  for (HT_Hash function = HT_HASH_MODULO; function <= HT_HASH_WYHASH; ++function) {
+    CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+    remove(HT_FILE);
+    remove(SHT_FILE);
+    HT_CreateFileHash(HT_FILE, BUCKETS, HT_MODE_STATIC, HT_HASH_FIBONACCI);
+    SHT_CreateSecondaryIndexHash(SHT_FILE, BUCKETS, HT_FILE, function);
+    HT_info* info = HT_OpenFile(HT_FILE);
+    SHT_info* index = SHT_OpenSecondaryIndex(SHT_FILE);
+
+    srand(12569874);
+    double insert = 0;
+    for (int i = 0; i < RECORDS; ++i) {
+      Record record = randomRecord();
+      record.id = i;
+      key_name(record.name, i);
+      int block_id = HT_InsertEntry(info, record);
+      struct timespec start;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      SHT_SecondaryInsertEntry(index, record, block_id);
+      insert += elapsed(&start);
+    }
+
+    srand(4242);
+    BF_ResetStats();
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < LOOKUPS; ++i) {
+      char name[15];
+      key_name(name, rand() % RECORDS);
+      SHT_SecondaryGetAllEntries(info, index, name);
+    }
+    double seconds = elapsed(&start);
+    BF_Stats stats;
+    BF_GetGlobalStats(&stats);
+    fprintf(stderr, "%-6s %-12s %-10s %14.2f %14.2f %14.2f\n", "SHT", "names", hash_names[function],
+            insert * 1e6 / RECORDS, (double)stats.gets / LOOKUPS, seconds * 1e6 / LOOKUPS);
+
+    SHT_CloseSecondaryIndex(index);
+    HT_CloseFile(info);
+    CALL_OR_DIE(BF_Close());
+  }
+  remove(HT_FILE);
+  remove(SHT_FILE);
+}
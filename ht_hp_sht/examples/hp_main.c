@@ -18,7 +18,7 @@
   }
 
 int main() {
-  BF_Init(LRU);
+  BF_Init(LRU, BF_DEFAULT_BLOCK_SIZE, BF_DEFAULT_BUFFER_SIZE);
 
   HP_CreateFile(FILE_NAME);
   HP_info* info = HP_OpenFile(FILE_NAME);
@@ -37,6 +37,17 @@ int main() {
   printf("\nSearching for: %d\n",id);
   HP_GetAllEntries(info, id);
 
+  printf("\nScanning for city: Athens\n");
+  Record_Predicate predicate = {CITY, EQUAL, 0, "Athens"};
+  HP_Scan* scan = HP_ScanOpen(info, &predicate);
+  const Record* match;
+  int matches = 0;
+  while ((match = HP_ScanNext(scan)) != NULL) {
+    matches++;
+  }
+  HP_ScanClose(scan);
+  printf("%d records\n", matches);
+
   HP_CloseFile(info);
   BF_Close();
 }
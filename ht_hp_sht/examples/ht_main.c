@@ -18,7 +18,7 @@
   }
 
 int main() {
-  BF_Init(LRU);
+  BF_Init(LRU, BF_DEFAULT_BLOCK_SIZE, BF_DEFAULT_BUFFER_SIZE);
 
   HT_CreateFile(FILE_NAME,10);
   HT_info* info = HT_OpenFile(FILE_NAME);
@@ -36,6 +36,7 @@ int main() {
   int id = rand() % RECORDS_NUM;
   HT_GetAllEntries(info, &id);
 
+  HT_Checkpoint(info);
   HashStatistics(FILE_NAME);
 
   HT_CloseFile(info);
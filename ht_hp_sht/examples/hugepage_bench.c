@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bf.h"
+#include "ht_table.h"
+
+#define HASH_FILE "hugepage_bench.db"
+#define HASH_RECORDS 2000000
+#define HASH_BUCKETS 400    // the directory has to fit in block 0
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 49152     // 192 MB, the whole file fits and every get is a hit
+#define GETS 4000000
+#define LOOKUPS 2000
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+const char* page_names[] = {"normal", "transparent", "hugetlb"};
+
+int gets[GETS];
+int offsets[GETS];
+
+/* Memory of the process that huge pages back, from /proc/self/smaps_rollup */
+long huge_page_kb() {
+  FILE* f = fopen("/proc/self/smaps_rollup", "r");
+  if (f == NULL) {
+    return -1;
+  }
+  char line[256];
+  long total = 0, kb;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1
+        || sscanf(line, "Private_Hugetlb: %ld kB", &kb) == 1) {
+      total += kb;
+    }
+  }
+  fclose(f);
+  return total;
+}
+
+double elapsed(struct timespec* start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main() {
+  srand(12569874);
+  remove(HASH_FILE);
+  CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+  HT_CreateFile(HASH_FILE, HASH_BUCKETS);
+  HT_info* info = HT_OpenFile(HASH_FILE);
+  for (int i = 0; i < HASH_RECORDS; ++i) {
+    HT_InsertEntry(info, randomRecord());
+  }
+  HT_CloseFile(info);
+  CALL_OR_DIE(BF_Close());
+
+  /* HT_GetAllEntries prints every match, keep them off the report */
+  freopen("/dev/null", "w", stdout);
+
+  fprintf(stderr, "%d random gets and %d HT lookups over %d records, %d frames of %d bytes\n",
+          GETS, LOOKUPS, HASH_RECORDS, POOL_SIZE, BLOCK_SIZE);
+  fprintf(stderr, "%-12s %-12s %12s %12s %14s\n",
+          "asked", "got", "huge MB", "ns/get", "lookups/sec");
+
+  BF_PoolPages asked[] = {BF_PAGES_NORMAL, BF_PAGES_TRANSPARENT, BF_PAGES_HUGETLB};
+  for (int p = 0; p < 3; ++p) {
+    CALL_OR_DIE(BF_SetPoolPages(asked[p]));
+    CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+    info = HT_OpenFile(HASH_FILE);
+    int blocks;
+    CALL_OR_DIE(BF_GetBlockCounter(info->fileDesc, &blocks));
+
+    /* Bring the whole file into the pool, the runs below only hit */
+    BF_Block* block;
+    BF_Block_Init(&block);
+    for (int b = 0; b < blocks; ++b) {
+      CALL_OR_DIE(BF_GetBlock(info->fileDesc, b, block));
+      CALL_OR_DIE(BF_UnpinBlock(block));
+    }
+    srand(4242);
+    for (int i = 0; i < GETS; ++i) {
+      gets[i] = rand() % blocks;
+      offsets[i] = rand() % (BLOCK_SIZE / sizeof(int));
+    }
+
+    struct timespec start;
+    long sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < GETS; ++i) {
+      CALL_OR_DIE(BF_GetBlock(info->fileDesc, gets[i], block));
+      sum += ((int*)BF_Block_GetData(block))[offsets[i]];
+      CALL_OR_DIE(BF_UnpinBlock(block));
+    }
+    double get_seconds = elapsed(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < LOOKUPS; ++i) {
+      int id = rand() % HASH_RECORDS;
+      HT_GetAllEntries(info, &id);
+    }
+    double lookup_seconds = elapsed(&start);
+
+    fprintf(stderr, "%-12s %-12s %12.1f %12.1f %14.0f\n",
+            page_names[asked[p]], page_names[BF_GetPoolPages()],
+            huge_page_kb() / 1024.0, get_seconds * 1e9 / GETS, LOOKUPS / lookup_seconds);
+    if (sum == 42) {
+      fprintf(stderr, "\n");   // keeps the reads of the data
+    }
+
+    BF_Block_Destroy(&block);
+    HT_CloseFile(info);
+    CALL_OR_DIE(BF_Close());
+  }
+
+  remove(HASH_FILE);
+}
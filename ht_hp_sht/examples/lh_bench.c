@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bf.h"
+#include "ht_table.h"
+
+#define STATIC_FILE "lh_bench_static.db"
+#define LINEAR_FILE "lh_bench_linear.db"
+#define HASH_BUCKETS 16     // both files start this small, only the linear one grows
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 65536     // 256 MB, the files fit and the runs count gets and not reads
+#define LOOKUPS 2000
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+double elapsed(struct timespec* start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Insert ids 0..records-1 one at a time, then look up existing ids. A split
+   is paid by a single insert, so the slowest insert is reported next to the mean */
+void measure(const char* name, HT_info* info, int records) {
+  double total = 0, worst = 0;
+  srand(12569874);
+  for (int i = 0; i < records; ++i) {
+    Record record = randomRecord();
+    record.id = i;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    HT_InsertEntry(info, record);
+    double seconds = elapsed(&start);
+    total += seconds;
+    if (seconds > worst) {
+      worst = seconds;
+    }
+  }
+
+  srand(4242);
+  BF_ResetStats();
+  for (int i = 0; i < LOOKUPS; ++i) {
+    int id = rand() % records;
+    HT_GetAllEntries(info, &id);
+  }
+  BF_Stats stats;
+  BF_GetGlobalStats(&stats);
+  fprintf(stderr, "%-7s %10d %8d %8d %14.2f %12.2f %12.1f\n", name, records, info->numBuckets,
+          info->splits, (double)stats.gets / LOOKUPS, total * 1e6 / records, worst * 1e6);
+}
+
+int main() {
+  /* The lookups print their matches, keep them off the report */
+  int report = dup(STDOUT_FILENO);
+  freopen("/dev/null", "w", stdout);
+
+  fprintf(stderr, "%d lookups of existing ids, static HT against linear hashing, both from %d buckets\n",
+          LOOKUPS, HASH_BUCKETS);
+  fprintf(stderr, "%-7s %10s %8s %8s %14s %12s %12s\n", "file", "records", "buckets", "splits",
+          "gets/lookup", "us/insert", "max insert");
+
+  for (int records = 1000; records <= 1000000; records *= 10) {
+    CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+    remove(STATIC_FILE);
+    remove(LINEAR_FILE);
+    HT_CreateFile(STATIC_FILE, HASH_BUCKETS);
+    HT_CreateFileLinear(LINEAR_FILE, HASH_BUCKETS);
+    HT_info* fixed = HT_OpenFile(STATIC_FILE);
+    HT_info* linear = HT_OpenFile(LINEAR_FILE);
+
+    measure("static", fixed, records);
+    measure("linear", linear, records);
+
+    HT_CloseFile(fixed);
+    HT_CloseFile(linear);
+    CALL_OR_DIE(BF_Close());
+  }
+
+  /* The header of the linear file was kept up to date on disk */
+  CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+  fflush(stdout);
+  dup2(report, STDOUT_FILENO);
+  HashStatistics(LINEAR_FILE);
+  CALL_OR_DIE(BF_Close());
+  remove(STATIC_FILE);
+  remove(LINEAR_FILE);
+}
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "bf.h"
+#include "ht_table.h"
+
+#define HASH_FILE "lookup_bench.db"
+#define HASH_RECORDS 20000
+#define HASH_BUCKETS 400    // the directory has to fit in block 0
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 2048      // the whole file fits, lookups measure the pool and not the disk
+#define LOOKUPS 200000      // split among the threads of each run
+#define MAX_THREADS 64
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+typedef struct {
+  HT_info* info;
+  int lookups;
+  unsigned int seed;
+} Worker;
+
+void* lookup_worker(void* arg) {
+  Worker* worker = arg;
+  for (int i = 0; i < worker->lookups; ++i) {
+    int id = rand_r(&worker->seed) % HASH_RECORDS;
+    HT_GetAllEntries(worker->info, &id);
+  }
+  return NULL;
+}
+
+double run_lookups(HT_info* info, int threads) {
+  pthread_t tids[MAX_THREADS];
+  Worker workers[MAX_THREADS];
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int t = 0; t < threads; ++t) {
+    workers[t].info = info;
+    workers[t].lookups = LOOKUPS / threads;
+    workers[t].seed = 1000 + t;
+    pthread_create(&tids[t], NULL, lookup_worker, &workers[t]);
+  }
+  for (int t = 0; t < threads; ++t) {
+    pthread_join(tids[t], NULL);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main() {
+  srand(12569874);
+  remove(HASH_FILE);
+  CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+  HT_CreateFile(HASH_FILE, HASH_BUCKETS);
+  HT_info* info = HT_OpenFile(HASH_FILE);
+  for (int i = 0; i < HASH_RECORDS; ++i) {
+    HT_InsertEntry(info, randomRecord());
+  }
+  HT_CloseFile(info);
+  CALL_OR_DIE(BF_Close());
+
+  /* HT_GetAllEntries prints every match, keep them off the report */
+  freopen("/dev/null", "w", stdout);
+
+  CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+  info = HT_OpenFile(HASH_FILE);
+  run_lookups(info, 1);   // warm up the pool
+
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  int max_threads = cores < 8 ? 8 : (cores > MAX_THREADS ? MAX_THREADS : cores);
+  fprintf(stderr, "%d HT lookups over %d records, %d frames, %ld cores\n",
+          LOOKUPS, HASH_RECORDS, POOL_SIZE, cores);
+  fprintf(stderr, "%8s %10s %14s %10s\n", "threads", "seconds", "lookups/sec", "speedup");
+
+  double base = 0;
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    double seconds = run_lookups(info, threads);
+    double rate = (LOOKUPS / threads * threads) / seconds;
+    if (threads == 1) {
+      base = rate;
+    }
+    fprintf(stderr, "%8d %10.3f %14.0f %9.2fx\n", threads, seconds, rate, rate / base);
+  }
+
+  HT_CloseFile(info);
+  CALL_OR_DIE(BF_Close());
+  remove(HASH_FILE);
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bf.h"
+#include "hp_file.h"
+
+#define HEAP_FILE "pax_bench.db"
+#define RECORDS 2000000
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 40960     // the whole file fits, the scans measure the filter and not the disk
+#define PASSES 5            // the best pass of each scan is reported
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+const char* layout_names[] = {"row", "pax", "dict", "slotted"};
+
+typedef struct {
+  const char* name;
+  Record_Predicate predicate;
+} Scan;
+
+Scan scans[] = {
+    {"id < 20000", {ID, LESS, 20000, NULL}},
+    {"id == 123456", {ID, EQUAL, 123456, NULL}},
+    {"name == Sofia", {NAME, EQUAL, 0, "Sofia"}},
+    {"city != Athens", {CITY, NOT_EQUAL, 0, "Athens"}},
+};
+
+Record records[RECORDS];
+
+double elapsed(struct timespec* start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main() {
+  srand(12569874);
+  for (int i = 0; i < RECORDS; ++i) {
+    records[i] = randomRecord();
+  }
+
+  fprintf(stderr, "%d records in %d-byte blocks, best of %d scans\n", RECORDS, BLOCK_SIZE, PASSES);
+  fprintf(stderr, "%-8s %-16s %8s %10s %10s %10s %14s %10s\n", "layout", "predicate",
+          "blocks", "rec/block", "matches", "seconds", "records/sec", "MB/sec");
+
+  HP_Layout layouts[] = {HP_LAYOUT_ROW, HP_LAYOUT_PAX, HP_LAYOUT_DICT, HP_LAYOUT_SLOTTED};
+  for (int l = 0; l < 4; ++l) {
+    HP_RemoveFile(HEAP_FILE);
+    CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+    HP_CreateFileLayout(HEAP_FILE, layouts[l]);
+    HP_info* info = HP_OpenFile(HEAP_FILE);
+    HP_UseZoneMap(info, 0);   // every block is filtered, the layouts are compared and not the zone map
+    HP_BulkInsert(info, records, RECORDS);
+    double megabytes = (double)info->last * BLOCK_SIZE / (1 << 20);
+
+    for (int s = 0; s < sizeof(scans) / sizeof(scans[0]); ++s) {
+      double best = 0;
+      int matches = 0;
+      for (int pass = 0; pass < PASSES; ++pass) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        HP_Scan* scan = HP_ScanOpen(info, &scans[s].predicate);
+        matches = 0;
+        while (HP_ScanNext(scan) != NULL) {
+          matches++;
+        }
+        HP_ScanClose(scan);
+        double seconds = elapsed(&start);
+        if (pass == 0 || seconds < best) {
+          best = seconds;
+        }
+      }
+      fprintf(stderr, "%-8s %-16s %8d %10.1f %10d %10.4f %14.0f %10.0f\n", layout_names[layouts[l]],
+              scans[s].name, info->last, (double)RECORDS / info->last, matches, best,
+              RECORDS / best, megabytes / best);
+    }
+
+    HP_CloseFile(info);
+    CALL_OR_DIE(BF_Close());
+  }
+  HP_RemoveFile(HEAP_FILE);
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bf.h"
+#include "hp_file.h"
+#include "ht_table.h"
+
+#define HASH_FILE "bench_hash.db"
+#define HEAP_FILE "bench_heap.db"
+#define HASH_RECORDS 1200
+#define HASH_BUCKETS 20
+#define HOT_BUCKETS 4       // lookups only ask for ids of the first HOT_BUCKETS buckets
+#define HEAP_RECORDS 3000
+#define POOL_SIZE 100
+#define ROUNDS 20
+#define LOOKUPS_PER_ROUND 40
+#define SCANS_PER_ROUND 1
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+const char* policy_names[] = {"LRU", "MRU", "CLOCK", "2Q", "LRU-K"};
+
+/* Build both files once with a pool large enough to hold them */
+void build_files() {
+  remove(HASH_FILE);
+  HP_RemoveFile(HEAP_FILE);
+  CALL_OR_DIE(BF_Init(LRU, BF_DEFAULT_BLOCK_SIZE, 10000));
+
+  HT_CreateFile(HASH_FILE, HASH_BUCKETS);
+  HT_info* ht_info = HT_OpenFile(HASH_FILE);
+  for (int i = 0; i < HASH_RECORDS; ++i) {
+    HT_InsertEntry(ht_info, randomRecord());
+  }
+  HT_CloseFile(ht_info);
+
+  HP_CreateFile(HEAP_FILE);
+  HP_info* hp_info = HP_OpenFile(HEAP_FILE);
+  for (int i = 0; i < HEAP_RECORDS; ++i) {
+    HP_InsertEntry(hp_info, randomRecord());
+  }
+  HP_CloseFile(hp_info);
+
+  CALL_OR_DIE(BF_Close());
+}
+
+int main() {
+  srand(12569874);
+  build_files();
+
+  /* HT_GetAllEntries and HP_GetAllEntries print every match, keep them off the report */
+  freopen("/dev/null", "w", stdout);
+
+  fprintf(stderr, "%d rounds of %d hot HT lookups and %d full HP scans, %d frames\n",
+          ROUNDS, LOOKUPS_PER_ROUND, SCANS_PER_ROUND, POOL_SIZE);
+  /* A get counts as a hit when it did not cost a read from disk, blocks that
+     BF_Prefetch brought into the pool were paid for as reads */
+  fprintf(stderr, "%-8s %10s %10s %10s %12s %12s %10s\n",
+          "policy", "gets", "reads", "hit ratio", "lookup hits", "evictions", "seconds");
+
+  for (ReplacementAlgorithm policy = LRU; policy <= LRU_K; policy++) {
+    srand(4242);
+    CALL_OR_DIE(BF_Init(policy, BF_DEFAULT_BLOCK_SIZE, POOL_SIZE));
+    HT_info* ht_info = HT_OpenFile(HASH_FILE);
+    HP_info* hp_info = HP_OpenFile(HEAP_FILE);
+    BF_ResetStats();
+
+    BF_Stats before, after;
+    long lookup_gets = 0, lookup_reads = 0;
+    clock_t start = clock();
+
+    for (int round = 0; round < ROUNDS; ++round) {
+      BF_GetGlobalStats(&before);
+      for (int i = 0; i < LOOKUPS_PER_ROUND; ++i) {
+        int id = (rand() % (HASH_RECORDS / HASH_BUCKETS)) * HASH_BUCKETS + rand() % HOT_BUCKETS;
+        HT_GetAllEntries(ht_info, &id);
+      }
+      BF_GetGlobalStats(&after);
+      lookup_gets += after.gets - before.gets;
+      lookup_reads += after.reads - before.reads;
+
+      for (int i = 0; i < SCANS_PER_ROUND; ++i) {
+        /* A scan without a predicate reads every block, zone maps cannot skip any */
+        HP_Scan* scan = HP_ScanOpen(hp_info, NULL);
+        while (HP_ScanNext(scan) != NULL) {
+        }
+        HP_ScanClose(scan);
+      }
+    }
+
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    BF_Stats stats;
+    BF_GetGlobalStats(&stats);
+    fprintf(stderr, "%-8s %10ld %10ld %9.1f%% %11.1f%% %12ld %10.3f\n",
+            policy_names[policy], stats.gets, stats.reads,
+            100.0 * (stats.gets - stats.reads) / stats.gets,
+            100.0 * (lookup_gets - lookup_reads) / lookup_gets,
+            stats.evictions, seconds);
+
+    HP_CloseFile(hp_info);
+    HT_CloseFile(ht_info);
+    CALL_OR_DIE(BF_Close());
+  }
+
+  remove(HASH_FILE);
+  HP_RemoveFile(HEAP_FILE);
+}
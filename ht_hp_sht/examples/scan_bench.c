@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bf.h"
+#include "hp_file.h"
+
+#define HEAP_FILE "scan_bench.db"
+#define RECORDS 2000000
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 40960     // the whole file fits, the scans measure the CPU and not the disk
+#define PASSES 3            // the best pass of each run is reported
+#define MAX_THREADS 64
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+typedef struct {
+  const char* name;
+  Record_Predicate predicate;
+} Scan;
+
+Scan scans[] = {
+    {"id < 20000", {ID, LESS, 20000, NULL}},
+    {"city != Athens", {CITY, NOT_EQUAL, 0, "Athens"}},
+};
+
+Record records[RECORDS];
+
+int main() {
+  srand(12569874);
+  for (int i = 0; i < RECORDS; ++i) {
+    records[i] = randomRecord();
+  }
+  HP_RemoveFile(HEAP_FILE);
+  CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+  HP_CreateFile(HEAP_FILE);
+  HP_info* info = HP_OpenFile(HEAP_FILE);
+  HP_BulkInsert(info, records, RECORDS);
+
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  int max_threads = cores < 8 ? 8 : (cores > MAX_THREADS ? MAX_THREADS : cores);
+  fprintf(stderr, "parallel scans of %d records in %d blocks, %ld cores, best of %d\n",
+          RECORDS, info->last, cores, PASSES);
+  fprintf(stderr, "%-16s %8s %10s %10s %14s %10s\n",
+          "predicate", "threads", "matches", "seconds", "records/sec", "speedup");
+
+  for (int s = 0; s < sizeof(scans) / sizeof(scans[0]); ++s) {
+    double base = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+      double best = 0;
+      int count = 0;
+      for (int pass = 0; pass < PASSES; ++pass) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        Record* matches;
+        count = HP_ParallelScan(info, &scans[s].predicate, threads, &matches);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        free(matches);
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        if (pass == 0 || seconds < best) {
+          best = seconds;
+        }
+      }
+      if (threads == 1) {
+        base = best;
+      }
+      fprintf(stderr, "%-16s %8d %10d %10.4f %14.0f %9.2fx\n",
+              scans[s].name, threads, count, best, RECORDS / best, base / best);
+    }
+  }
+
+  HP_CloseFile(info);
+  CALL_OR_DIE(BF_Close());
+  HP_RemoveFile(HEAP_FILE);
+}
@@ -22,7 +22,7 @@
 
 int main() {
     srand(12569874);
-    BF_Init(LRU);
+    BF_Init(LRU, BF_DEFAULT_BLOCK_SIZE, BF_DEFAULT_BUFFER_SIZE);
     // Αρχικοποιήσεις
     HT_CreateFile(FILE_NAME,10);
     SHT_CreateSecondaryIndex(INDEX_NAME,10,FILE_NAME);
@@ -47,6 +47,7 @@ int main() {
 
     
     
+    SHT_Checkpoint(index_info);
     SHashStatistics(INDEX_NAME);
 
 
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bf.h"
+#include "hp_file.h"
+
+#define HEAP_FILE "zone_bench.db"
+#define RECORDS 2000000
+#define BLOCK_SIZE 4096
+#define POOL_SIZE 40960     // the whole file fits, the runs measure the blocks read and not the disk
+#define LOOKUPS 200
+#define RANGE 20000         // ids of each range scan
+
+#define CALL_OR_DIE(call)     \
+  {                           \
+    BF_ErrorCode code = call; \
+    if (code != BF_OK) {      \
+      BF_PrintError(code);    \
+      exit(code);             \
+    }                         \
+  }
+
+Record records[RECORDS];
+
+double elapsed(struct timespec* start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Point lookups with HP_GetAllEntries and range scans on id, with the ids
+   of the file in insert order or shuffled over the blocks */
+void run(const char* name) {
+  CALL_OR_DIE(BF_Init(LRU, BLOCK_SIZE, POOL_SIZE));
+  HP_CreateFile(HEAP_FILE);
+  HP_info* info = HP_OpenFile(HEAP_FILE);
+  HP_BulkInsert(info, records, RECORDS);
+
+  srand(4242);
+  BF_ResetStats();
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < LOOKUPS; ++i) {
+    HP_GetAllEntries(info, rand() % RECORDS);
+  }
+  double lookup_seconds = elapsed(&start);
+  BF_Stats lookup;
+  BF_GetGlobalStats(&lookup);
+
+  BF_ResetStats();
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  long matches = 0;
+  for (int i = 0; i < LOOKUPS; ++i) {
+    int low = rand() % (RECORDS - RANGE);
+    Record_Predicate predicate = {ID, GREATER_EQUAL, low, NULL};
+    HP_Scan* scan = HP_ScanOpen(info, &predicate);
+    const Record* record;
+    while ((record = HP_ScanNext(scan)) != NULL) {
+      matches += record->id < low + RANGE;
+    }
+    HP_ScanClose(scan);
+  }
+  double range_seconds = elapsed(&start);
+  BF_Stats range;
+  BF_GetGlobalStats(&range);
+
+  fprintf(stderr, "%-10s %8d %14.1f %12.3f %14.1f %12.3f\n", name, info->last,
+          (double)lookup.gets / LOOKUPS, lookup_seconds * 1e3 / LOOKUPS,
+          (double)range.gets / LOOKUPS, range_seconds * 1e3 / LOOKUPS);
+  if (matches == 42) {
+    fprintf(stderr, "\n");   // keeps the reads of the records
+  }
+
+  HP_CloseFile(info);
+  CALL_OR_DIE(BF_Close());
+  HP_RemoveFile(HEAP_FILE);
+}
+
+int main() {
+  srand(12569874);
+  for (int i = 0; i < RECORDS; ++i) {
+    records[i] = randomRecord();
+    records[i].id = i;
+  }
+
+  /* HP_GetAllEntries prints the match, keep it off the report */
+  freopen("/dev/null", "w", stdout);
+
+  fprintf(stderr, "%d point lookups and scans of id >= x over %d records\n", LOOKUPS, RECORDS);
+  fprintf(stderr, "%-10s %8s %14s %12s %14s %12s\n",
+          "ids", "blocks", "gets/lookup", "ms/lookup", "gets/scan", "ms/scan");
+
+  HP_RemoveFile(HEAP_FILE);
+  run("ordered");
+
+  /* The same ids in random order, every block spans nearly all of them */
+  for (int i = RECORDS - 1; i > 0; --i) {
+    int j = rand() % (i + 1);
+    int id = records[i].id;
+    records[i].id = records[j].id;
+    records[j].id = id;
+  }
+  run("shuffled");
+}
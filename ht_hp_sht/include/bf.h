@@ -5,9 +5,11 @@
 extern "C" {
 #endif
 
-#define BF_BLOCK_SIZE 512      /* Το μέγεθος ενός block σε bytes */
-#define BF_BUFFER_SIZE 100     /* Ο μέγιστος αριθμός block που κρατάμε στην μνήμη */
-#define BF_MAX_OPEN_FILES 100  /* Ο μέγιστος αριθμός ανοικτών αρχείων */
+#define BF_DEFAULT_BLOCK_SIZE 512     /* Το προεπιλεγμένο μέγεθος ενός block σε bytes */
+#define BF_DEFAULT_BUFFER_SIZE 100    /* Ο προεπιλεγμένος αριθμός block που κρατάμε στην μνήμη */
+#define BF_MIN_BLOCK_SIZE 512         /* Το ελάχιστο επιτρεπτό μέγεθος block */
+#define BF_MAX_BLOCK_SIZE 65536       /* Το μέγιστο επιτρεπτό μέγεθος block */
+#define BF_MAX_OPEN_FILES 100         /* Ο μέγιστος αριθμός ανοικτών αρχείων */
 
 typedef enum BF_ErrorCode {
   BF_OK,
@@ -18,14 +20,55 @@ typedef enum BF_ErrorCode {
   BF_FULL_MEMORY_ERROR,          /* Η μνήμη έχει γεμίσει με ενεργά block */
   BF_INVALID_BLOCK_NUMBER_ERROR, /* Το block που ζητήθηκε δεν υπάρχει στο αρχείο */
   BF_AVAILABLE_PIN_BLOCKS_ERROR, /* Το αρχειο δεν μπορεί να κλείσει επειδή υπάρχουν ενεργά Block στην μνήμη */
+  BF_INVALID_CONFIG_ERROR,       /* Μη έγκυρο μέγεθος block ή μέγεθος ενδιάμεσης μνήμης στην BF_Init */
   BF_ERROR
 } BF_ErrorCode;
 
+#define BF_LRU_K 2     /* Πόσες τελευταίες αναφορές κρατάει για κάθε block η LRU_K */
+
 typedef enum ReplacementAlgorithm {
   LRU,
-  MRU
+  MRU,
+  CLOCK,   /* Δεύτερη ευκαιρία με bit αναφοράς ανά block */
+  TWO_Q,   /* 2Q: τα block που διαβάστηκαν μία φορά δεν διώχνουν τα συχνά */
+  LRU_K    /* Διώχνει το block με την παλαιότερη BF_LRU_K-οστή αναφορά */
 } ReplacementAlgorithm;
 
+typedef enum BF_OpenMode {
+  BF_OPEN_BUFFERED,   /* Τα block διαβάζονται σε θέσεις της ενδιάμεσης μνήμης */
+  BF_OPEN_MMAP,       /* Τα block που υπάρχουν ήδη διαβάζονται απευθείας από mmap */
+  BF_OPEN_DIRECT      /* O_DIRECT: τα block δεν περνούν από την cache σελίδων του πυρήνα */
+} BF_OpenMode;
+
+/* Μετρητές της ενδιάμεσης μνήμης από την BF_Init ή την τελευταία BF_ResetStats,
+   για όλα τα αρχεία (BF_GetGlobalStats) ή για ένα αρχείο (BF_GetStats) */
+typedef struct BF_Stats {
+  long gets;        /* κλήσεις της BF_GetBlock */
+  long hits;        /* block που βρέθηκαν ήδη στην μνήμη, οι αστοχίες είναι gets - hits */
+  long reads;       /* block που διαβάστηκαν από τον δίσκο */
+  long evictions;   /* block που βγήκαν από την μνήμη για να μπει άλλο */
+  long prefetches;  /* block που ζητήθηκαν ασύγχρονα με την BF_Prefetch */
+  long writes;      /* dirty block που γράφτηκαν στον δίσκο */
+  long pins;        /* block καρφιτσωμένα αυτή τη στιγμή, δεν μηδενίζεται */
+  long bytes_read;     /* bytes που διαβάστηκαν από τον δίσκο */
+  long bytes_written;  /* bytes που γράφτηκαν στον δίσκο */
+  long io_calls;    /* κλήσεις συστήματος για ανάγνωση/εγγραφή block, μόνο
+                       στους συνολικούς μετρητές */
+  long io_calls_saved; /* εγγραφές block που ενώθηκαν με το προηγούμενο διαδοχικό
+                          block στην ίδια pwritev (ή εγγραφή του io_uring) */
+} BF_Stats;
+
+typedef enum BF_IOBackend {
+  BF_IO_PSYNC,   /* pread/pwrite, μία κλήση συστήματος ανά block */
+  BF_IO_URING    /* io_uring, μία υποβολή για κάθε ομάδα αναγνώσεων/εγγραφών */
+} BF_IOBackend;
+
+typedef enum BF_PoolPages {
+  BF_PAGES_NORMAL,       /* Σελίδες των 4 KB */
+  BF_PAGES_TRANSPARENT,  /* Διαφανείς σελίδες των 2 MB (THP), όπου τις δίνει ο πυρήνας */
+  BF_PAGES_HUGETLB       /* Σελίδες των 2 MB από το απόθεμα hugetlb του πυρήνα */
+} BF_PoolPages;
+
 
 // Δομή Block
 typedef struct BF_Block BF_Block;
@@ -42,6 +85,21 @@ void BF_Block_Init(BF_Block **block);
  */
 void BF_Block_Destroy(BF_Block **block);
 
+/*
+ * Χώρος για μια δομή BF_Block που βρίσκεται μέσα σε άλλη δομή ή στη στοίβα,
+ * ώστε να μη χρειάζεται δέσμευση μνήμης για κάθε block που ζητάμε.
+ */
+typedef struct BF_BlockStorage {
+  void *opaque[4];
+} BF_BlockStorage;
+
+/*
+ * Η συνάρτηση BF_Block_InitIn αρχικοποιεί μια δομή BF_Block μέσα στον χώρο
+ * storage και επιστρέφει δείκτη σε αυτή. Δεν δεσμεύεται μνήμη, οπότε η δομή
+ * ζει όσο και ο χώρος storage και δεν καλείται γι' αυτή η BF_Block_Destroy.
+ */
+BF_Block *BF_Block_InitIn(BF_BlockStorage *storage);
+
 /*
  * Η συνάρτηση BF_Block_SetDirty αλλάζει την κατάσταση του block σε dirty.
  * Αυτό πρακτικά σημαίνει ότι τα δεδομένα του block έχουν αλλαχθεί και το
@@ -60,10 +118,67 @@ char* BF_Block_GetData(const BF_Block *block);
 
 /*
  * Με τη συνάρτηση BF_Init πραγματοποιείται η αρχικοποίηση του επιπέδου BF.
- * Μπορούμε να επιλέξουμε ανάμεσα σε δύο πολιτικές αντικατάστασις Block
- * εκείνης της LRU και εκείνης της MRU.
+ * Μπορούμε να επιλέξουμε ανάμεσα στις πολιτικές αντικατάστασις Block
+ * LRU, MRU, CLOCK, TWO_Q και LRU_K. Οι τρεις τελευταίες δεν αφήνουν μια
+ * σειριακή ανάγνωση μεγάλου αρχείου να διώξει τα block που ζητούνται
+ * συχνά. Το block_size είναι το μέγεθος κάθε
+ * block σε bytes (δύναμη του 2 από BF_MIN_BLOCK_SIZE έως BF_MAX_BLOCK_SIZE,
+ * π.χ. 4096, 8192 ή 16384) και το buffer_size ο αριθμός των block που
+ * χωράει η ενδιάμεση μνήμη. Αν δοθεί 0 χρησιμοποιούνται οι τιμές
+ * BF_DEFAULT_BLOCK_SIZE και BF_DEFAULT_BUFFER_SIZE αντίστοιχα. Όλα τα
+ * αρχεία που ανοίγονται μέχρι την BF_Close διαβάζονται με αυτό το μέγεθος
+ * block.
+ *
+ * Οι BF_GetBlock, BF_UnpinBlock, BF_Block_SetDirty, BF_AllocateBlock και
+ * BF_Prefetch μπορούν να καλούνται ταυτόχρονα από πολλά νήματα. Η ενδιάμεση
+ * μνήμη χωρίζεται σε έως 16 τμήματα (ένα ανά 64 θέσεις), το καθένα με δική
+ * του κλειδαριά, πίνακα σελίδων και πολιτική αντικατάστασης, και κάθε block
+ * ανήκει στο τμήμα που δίνει ο κατακερματισμός του. Οι BF_Init, BF_Close,
+ * BF_OpenFile και BF_CloseFile δεν πρέπει να τρέχουν μαζί με άλλες κλήσεις
+ * για τα ίδια αρχεία.
  */
-BF_ErrorCode BF_Init(const ReplacementAlgorithm repl_alg);
+BF_ErrorCode BF_Init(const ReplacementAlgorithm repl_alg,
+                     const int block_size,
+                     const int buffer_size);
+
+/*
+ * Η συνάρτηση BF_SetPoolPages ορίζει, πριν την BF_Init, με τι σελίδες
+ * δεσμεύεται η ενδιάμεση μνήμη και ο πίνακας με τις θέσεις της, όταν το
+ * καθένα ξεπερνά τα 2 MB. Με BF_PAGES_HUGETLB (η προεπιλογή) δοκιμάζεται
+ * πρώτα το απόθεμα hugetlb (MAP_HUGETLB), μετά οι διαφανείς σελίδες και
+ * τέλος οι κανονικές. Με BF_PAGES_TRANSPARENT παραλείπεται το πρώτο βήμα
+ * και με BF_PAGES_NORMAL χρησιμοποιούνται μόνο κανονικές σελίδες. Οι μεγάλες
+ * σελίδες μειώνουν τις αστοχίες του TLB όταν τα block που ζητούνται είναι
+ * σκορπισμένα σε μεγάλη ενδιάμεση μνήμη. Αν το επίπεδο BF είναι ενεργό
+ * επιστρέφεται BF_ACTIVE_ERROR, αλλιώς BF_OK.
+ */
+BF_ErrorCode BF_SetPoolPages(const BF_PoolPages pages);
+
+/*
+ * Η συνάρτηση BF_GetPoolPages επιστρέφει με τι σελίδες δέσμευσε η τελευταία
+ * BF_Init την ενδιάμεση μνήμη. Με BF_PAGES_TRANSPARENT ο πυρήνας μπορεί να
+ * δώσει μεγάλες σελίδες μόνο σε μέρος της.
+ */
+BF_PoolPages BF_GetPoolPages();
+
+/*
+ * Η συνάρτηση BF_GetIOBackend επιστρέφει τον τρόπο με τον οποίο το επίπεδο BF
+ * διαβάζει και γράφει block. Η BF_Init χρησιμοποιεί io_uring όταν το
+ * υποστηρίζει ο πυρήνας (και δεν έχει γίνει μεταγλώττιση με -DBF_NO_IO_URING):
+ * οι εγγραφές των dirty block στην BF_CloseFile, στην BF_Close και κατά την
+ * αντικατάσταση υποβάλλονται μαζί. Μια αστοχία της BF_GetBlock διαβάζει μόνο
+ * το block που ζητήθηκε, οπότε υποβάλλεται μόνη της, και η BF_Prefetch
+ * δίνει πάντα μόνο υπόδειξη στον πυρήνα. Αλλιώς χρησιμοποιούνται
+ * pread/pwrite.
+ */
+BF_IOBackend BF_GetIOBackend();
+
+/*
+ * Η συνάρτηση BF_GetBlockSize επιστρέφει το μέγεθος block σε bytes με το
+ * οποίο αρχικοποιήθηκε το επίπεδο BF (ή BF_DEFAULT_BLOCK_SIZE αν δεν έχει
+ * κληθεί ακόμη η BF_Init).
+ */
+int BF_GetBlockSize();
 
 /*
  * Η συνάρτηση BF_CreateFile δημιουργεί ένα αρχείο με όνομα filename το
@@ -83,6 +198,35 @@ BF_ErrorCode BF_CreateFile(const char* filename);
  */
 BF_ErrorCode BF_OpenFile(const char* filename, int *file_desc);
 
+/*
+ * Η συνάρτηση BF_OpenFileMode λειτουργεί όπως η BF_OpenFile (που ισοδυναμεί
+ * με mode BF_OPEN_BUFFERED). Με mode BF_OPEN_MMAP τα block που υπάρχουν στο
+ * αρχείο κατά το άνοιγμα απεικονίζονται στην μνήμη με mmap και η BF_GetBlock
+ * επιστρέφει δείκτη κατευθείαν μέσα στην απεικόνιση χωρίς αντιγραφή, ενώ το
+ * pin/unpin απλά μετράει τα ενεργά block. Όταν ένα τέτοιο block γίνει dirty
+ * αντιγράφεται σε θέση της ενδιάμεσης μνήμης και γράφεται στον δίσκο όπως
+ * κάθε άλλο. Αν το block έχει ήδη αντιγραφεί μέσω άλλου BF_Block, η
+ * BF_Block_SetDirty αντιγράφει ξανά την απεικόνιση πάνω στη θέση, ώστε να
+ * μη χαθούν οι αλλαγές που έγιναν μέσω του δεύτερου. Η επιλογή αφορά αρχεία
+ * που διαβάζονται κυρίως.
+ *
+ * Με mode BF_OPEN_DIRECT το αρχείο ανοίγεται με O_DIRECT, οπότε τα block
+ * κρατιούνται μόνο στην ενδιάμεση μνήμη του BF και όχι δεύτερη φορά στην
+ * cache σελίδων του πυρήνα. Τότε μια μεγάλη ενδιάμεση μνήμη αντικαθιστά την
+ * cache σελίδων με προβλέψιμη χρήση μνήμης, αλλά κάθε αστοχία πηγαίνει στον
+ * δίσκο. Οι θέσεις της ενδιάμεσης μνήμης είναι στοιχισμένες και το μέγεθος
+ * block πρέπει να είναι πολλαπλάσιο του μεγέθους τομέα της συσκευής, αλλιώς
+ * επιστρέφεται BF_INVALID_CONFIG_ERROR. Αν το σύστημα αρχείων δεν υποστηρίζει
+ * O_DIRECT (π.χ. tmpfs) επιστρέφεται BF_ERROR. Η BF_Prefetch δεν κάνει
+ * τίποτα για τέτοια αρχεία, αφού δεν χρησιμοποιούν την cache σελίδων.
+ *
+ * Ο τρόπος ανοίγματος δεν έχει αποτέλεσμα αν το αρχείο είναι ήδη ανοιχτό από
+ * άλλο file_desc.
+ */
+BF_ErrorCode BF_OpenFileMode(const char* filename,
+                             int *file_desc,
+                             const BF_OpenMode mode);
+
 /*
  * Η συνάρτηση BF_CloseFile κλείνει το ανοιχτό αρχείο με αναγνωριστικό αριθμό
  * file_desc. Σε περίπτωση επιτυχίας επιστρέφεται BF_OK ενώ σε περίπτωση
@@ -115,6 +259,24 @@ BF_ErrorCode BF_GetBlockCounter(const int file_desc, int *blocks_num);
  */
 BF_ErrorCode BF_AllocateBlock(const int file_desc, BF_Block *block);
 
+/*
+ * Η συνάρτηση BF_AllocateBlocks δεσμεύει n συνεχόμενα block στο τέλος του
+ * αρχείου file_desc με μία κλήση fallocate, ώστε το αρχείο να μεγαλώνει κατά
+ * ομάδες (extents) που μένουν συνεχόμενες στον δίσκο. Ο αριθμός του πρώτου
+ * block επιστρέφεται στην μεταβλητή first_block (αν δεν είναι NULL). Τα νέα
+ * block περιέχουν μηδενικά και δεν χρειάζεται να γίνουν dirty για να
+ * υπάρξουν στον δίσκο. Αν ο πίνακας blocks δεν είναι NULL πρέπει να έχει n
+ * δομές αρχικοποιημένες με την BF_Block_Init, και το block first_block + i
+ * καρφιτσώνεται στην blocks[i] (κάθε ένα θέλει BF_UnpinBlock). Αλλιώς τα
+ * block δεν καρφιτσώνονται και μπαίνουν μόνο σε ελεύθερες θέσεις της
+ * ενδιάμεσης μνήμης. Σε περίπτωση επιτυχίας επιστρέφεται BF_OK ενώ σε
+ * περίπτωση αποτυχίας, επιστρέφεται ένας κωδικός λάθους.
+ */
+BF_ErrorCode BF_AllocateBlocks(const int file_desc,
+                               const int n,
+                               int *first_block,
+                               BF_Block **blocks);
+
 
 /*
  * Η συνάρτηση BF_GetBlock βρίσκει το block με αριθμό block_num του ανοιχτού
@@ -129,6 +291,21 @@ BF_ErrorCode BF_GetBlock(const int file_desc,
                          const int block_num,
                          BF_Block *block);
 
+/*
+ * Η συνάρτηση BF_Prefetch ενημερώνει το επίπεδο BF ότι σύντομα θα ζητηθούν
+ * τα n block με αριθμούς block_ids του αρχείου file_desc. Η ανάγνωση όσων
+ * δεν βρίσκονται ήδη στην ενδιάμεση μνήμη ξεκινάει ασύγχρονα από τον πυρήνα
+ * (posix_fadvise/madvise) και η συνάρτηση επιστρέφει αμέσως, ώστε η επόμενη
+ * BF_GetBlock να μην περιμένει τον δίσκο. Αυτό ισχύει και όταν το επίπεδο
+ * χρησιμοποιεί io_uring. Για αρχεία O_DIRECT, που δεν περνούν από τη μνήμη
+ * του πυρήνα, η κλήση δεν κάνει τίποτα. Τα block δεν καρφιτσώνονται και
+ * αριθμοί εκτός αρχείου αγνοούνται. Σε περίπτωση επιτυχίας επιστρέφεται BF_OK
+ * ενώ σε περίπτωση αποτυχίας, επιστρέφεται ένας κωδικός λάθους.
+ */
+BF_ErrorCode BF_Prefetch(const int file_desc,
+                         const int *block_ids,
+                         const int n);
+
 /*
  * Η συνάρτηση BF_UnpinBlock αποδεσμεύει το block από το επίπεδο Block το
  * οποίο κάποια στηγμή θα το γράψει στο δίσκο. Σε περίπτωση επιτυχίας
@@ -145,9 +322,33 @@ BF_ErrorCode BF_UnpinBlock(BF_Block *block);
  */
 void BF_PrintError(BF_ErrorCode err);
 
+/*
+ * Η συνάρτηση BF_GetStats επιστρέφει στην μεταβλητή stats τους μετρητές της
+ * ενδιάμεσης μνήμης για το αρχείο file_desc. Οι μετρητές αφορούν το αρχείο και
+ * όχι το file_desc, αν είναι ανοιχτό από πολλά file_desc είναι κοινοί. Με δύο
+ * κλήσεις πριν και μετά από μια λειτουργία (π.χ. HT_InsertEntry) φαίνεται
+ * πόσο I/O κόστισε. Σε περίπτωση επιτυχίας επιστρέφεται BF_OK ενώ σε
+ * περίπτωση αποτυχίας, επιστρέφεται ένας κωδικός λάθους.
+ */
+BF_ErrorCode BF_GetStats(const int file_desc, BF_Stats *stats);
+
+/*
+ * Η συνάρτηση BF_GetGlobalStats επιστρέφει στην μεταβλητή stats τους
+ * μετρητές της ενδιάμεσης μνήμης για όλα τα αρχεία.
+ */
+void BF_GetGlobalStats(BF_Stats *stats);
+
+/*
+ * Η συνάρτηση BF_ResetStats μηδενίζει τους μετρητές της ενδιάμεσης μνήμης,
+ * τους συνολικούς και όλων των αρχείων.
+ */
+void BF_ResetStats();
+
 /*
  * Η συνάρτηση BF_Close κλήνει το επίπεδο Block γράφοντας στον δίσκο όποια
- * block είχε στην μνήμη.
+ * block είχε στην μνήμη. Όπως και στην BF_CloseFile και κατά την αντικατάσταση,
+ * τα dirty block ταξινομούνται κατά αριθμό και κάθε σειρά διαδοχικών block
+ * γράφεται με μία κλήση pwritev.
  */
 BF_ErrorCode BF_Close();
 
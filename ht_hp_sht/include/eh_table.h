@@ -0,0 +1,69 @@
+#ifndef EH_TABLE_H
+#define EH_TABLE_H
+#include <record.h>
+#include "bf.h"
+
+/* Το μεγαλύτερο ολικό βάθος του καταλόγου, δηλαδή ως 2^24 θέσεις */
+#define EH_MAX_DEPTH 24
+
+/* Η επικεφαλίδα του αρχείου επεκτατού κατακερματισμού, στο block 0 */
+typedef struct {
+    int fileDesc;           /* αναγνωριστικός αριθμός ανοίγματος αρχείου από το επίπεδο block */
+    int globalDepth;        /* ο κατάλογος έχει 2^globalDepth θέσεις */
+    int dirFirst;           /* το πρώτο από τα συνεχόμενα block του καταλόγου */
+    int dirBlocks;          /* πόσα block πιάνει ο κατάλογος */
+    int buckets;            /* το πλήθος των κάδων */
+    int splits;             /* πόσες φορές χωρίστηκε κάδος */
+    int doublings;          /* πόσες φορές διπλασιάστηκε ο κατάλογος */
+    BF_Block *first_block;  /* το block 0, καρφιτσωμένο όσο είναι ανοιχτό */
+    BF_BlockStorage handles[2]; /* τα block της EH_InsertEntry, ώστε να μη
+                                   δεσμεύεται μνήμη σε κάθε εισαγωγή */
+} EH_info;
+
+/* Αποθηκεύεται στο τέλος κάθε κάδου */
+typedef struct {
+    int recordsCounter;     /* αριθμός των εγγραφών στον κάδο */
+    int localDepth;         /* τα bit του κατακερματισμού που μοιράζονται
+                               όλες οι εγγραφές του κάδου */
+} EH_block_info;
+
+
+/*Η συνάρτηση EH_CreateFile δημιουργεί ένα άδειο αρχείο επεκτατού
+κατακερματισμού με όνομα fileName, με έναν κάδο και κατάλογο μίας θέσης.
+Δεν χρειάζεται πλήθος κάδων: όταν ένας κάδος γεμίσει χωρίζεται στα δύο, και
+ο κατάλογος διπλασιάζεται μόνο όταν το τοπικό βάθος του κάδου φτάσει το
+ολικό. Σε περίπτωση που εκτελεστεί επιτυχώς, επιστρέφεται 0, ενώ σε
+διαφορετική περίπτωση -1.*/
+int EH_CreateFile(char *fileName /*όνομα αρχείου*/);
+
+/*Η συνάρτηση EH_OpenFile ανοίγει το αρχείο με όνομα fileName και
+επιστρέφει τη δομή με την επικεφαλίδα του, ή NULL σε περίπτωση λάθους.*/
+EH_info* EH_OpenFile(char *fileName /*όνομα αρχείου*/);
+
+/*Η συνάρτηση EH_CloseFile γράφει την επικεφαλίδα στο block 0, κλείνει
+το αρχείο και αποδεσμεύει τη δομή header_info. Σε περίπτωση που εκτελεστεί
+επιτυχώς, επιστρέφεται 0, ενώ σε διαφορετική περίπτωση -1.*/
+int EH_CloseFile(EH_info* header_info);
+
+/*Η συνάρτηση EH_InsertEntry εισάγει την εγγραφή record στον κάδο που
+δείχνει ο κατάλογος για το id της. Αν ο κάδος είναι γεμάτος χωρίζεται,
+διπλασιάζοντας πρώτα τον κατάλογο αν χρειαστεί. Επιστρέφει τον αριθμό του
+block στο οποίο έγινε η εισαγωγή, ή -1 σε περίπτωση λάθους ή αν ο κάδος
+δεν χωρίζεται ούτε με βάθος EH_MAX_DEPTH (πάρα πολλές εγγραφές με το ίδιο id).*/
+int EH_InsertEntry(EH_info* header_info, /*επικεφαλίδα του αρχείου*/
+    Record record /*δομή που προσδιορίζει την εγγραφή*/);
+
+/*Η συνάρτηση EH_GetAllEntries εκτυπώνει όλες τις εγγραφές με id ίσο με
+*value. Διαβάζει ένα block του καταλόγου και έναν κάδο, όσο μεγάλο κι αν
+είναι το αρχείο. Επιστρέφει το πλήθος των block δεδομένων που διαβάστηκαν
+αν βρέθηκε εγγραφή, αλλιώς -1.*/
+int EH_GetAllEntries(EH_info* header_info, /*επικεφαλίδα του αρχείου*/
+    void *value /*τιμή του πεδίου-κλειδιού προς αναζήτηση*/);
+
+/*Η συνάρτηση EH_HashStatistics τυπώνει το ολικό βάθος, το μέγεθος του
+καταλόγου, το πλήθος των κάδων, των χωρισμών και των διπλασιασμών, και
+το ελάχιστο, μέσο και μέγιστο πλήθος εγγραφών ανά κάδο του ανοιχτού
+αρχείου header_info. Επιστρέφει 0, ή -1 σε περίπτωση λάθους.*/
+int EH_HashStatistics(EH_info* header_info);
+
+#endif // EH_TABLE_H
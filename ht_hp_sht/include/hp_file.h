@@ -1,15 +1,69 @@
 #ifndef HP_FILE_H
 #define HP_FILE_H
+#include <stddef.h>
 #include <record.h>
 #include "bf.h"
 
 
+/* Η διάταξη των εγγραφών μέσα σε κάθε block του αρχείου σωρού */
+typedef enum HP_Layout {
+    HP_LAYOUT_ROW,   /* οι εγγραφές Record η μία μετά την άλλη */
+    HP_LAYOUT_PAX,   /* κάθε πεδίο των εγγραφών ως συνεχής στήλη μέσα στο block */
+    HP_LAYOUT_DICT,  /* το id και οι κωδικοί των συμβολοσειρών στα λεξικά του αρχείου */
+    HP_LAYOUT_SLOTTED /* εγγραφές μεταβλητού μήκους πίσω από κατάλογο θέσεων */
+} HP_Layout;
+
+/* Οι διαφορετικές τιμές που χωράνε σε κάθε στήλη του λεξικού, ώστε ο
+   κωδικός μιας τιμής να είναι ένα byte */
+#define HP_DICT_SIZE 256
+#define HP_DICT_COLUMNS 4
+#define HP_DICT_WIDTH 20    /* το πλάτος του μεγαλύτερου πεδίου συμβολοσειράς */
+
+/* Τα λεξικά ενός αρχείου HP_LAYOUT_DICT. Η στήλη 0 κρατάει τις ετικέτες
+   record και οι στήλες NAME, SURNAME και CITY τις αντίστοιχες τιμές, ώστε ο
+   κωδικός της τιμής values[c][k] μέσα στα block να είναι το k */
+typedef struct {
+    int counts[HP_DICT_COLUMNS];
+    char values[HP_DICT_COLUMNS][HP_DICT_SIZE][HP_DICT_WIDTH];
+} HP_Dictionary;
+
+/* Λέξεις των 64 bit για ένα bit ανά εγγραφή του μεγαλύτερου block */
+#define HP_SCAN_WORDS ((BF_MAX_BLOCK_SIZE / sizeof(Record) + 63) / 64)
+
+/* Το εύρος των id των εγγραφών ενός block, min_id > max_id αν είναι άδειο */
+typedef struct {
+    int min_id;
+    int max_id;
+} HP_Zone;
+
 /* Η δομή HP_info κρατάει μεταδεδομένα που σχετίζονται με το αρχείο σωρού*/
 typedef struct {
     int fileDesc; /* αναγνωριστικός αριθμός ανοίγματος
                      αρχείου από το επίπεδο block */
     int last;
     BF_Block *first_block;
+    BF_BlockStorage handles[2]; /* τα block της HP_InsertEntry, ώστε να μη
+                                   δεσμεύεται μνήμη σε κάθε εισαγωγή */
+    int layout;                 /* HP_Layout των block του αρχείου */
+    int appending;              /* 1 από την HP_BeginAppend ως την HP_EndAppend */
+    BF_BlockStorage tail_storage;
+    BF_Block *tail;             /* το τελευταίο block, καρφιτσωμένο όσο
+                                   είναι ανοιχτός ο δρομέας προσθήκης */
+    int zoneDesc;               /* το αρχείο fileName.zm του χάρτη ζωνών,
+                                   -1 αν δεν υπάρχει ακόμα */
+    char *zone_name;            /* το όνομα του fileName.zm, ώστε να
+                                   δημιουργηθεί στο κλείσιμο αν χρειαστεί */
+    HP_Zone *zones;             /* το εύρος των id κάθε block, στη μνήμη
+                                   από την HP_OpenFile ως την HP_CloseFile */
+    int zone_capacity;
+    int zoned;                  /* 1 όταν ο χάρτης καλύπτει όλα τα block */
+    int zone_dirty;             /* 1 αν ο χάρτης άλλαξε από το άνοιγμα */
+    int zone_skip;              /* 0 αν οι σαρώσεις δεν τον χρησιμοποιούν */
+    unsigned long long file_id; /* η ταυτότητα του αρχείου από τη δημιουργία
+                                   του, γράφεται και στο fileName.zm */
+    int dictDesc;               /* το αρχείο fileName.dict των λεξικών, -1
+                                   αν η διάταξη δεν είναι HP_LAYOUT_DICT */
+    HP_Dictionary *dict;        /* τα λεξικά, στη μνήμη όσο είναι ανοιχτό */
 } HP_info;
 
 typedef struct {
@@ -17,6 +71,25 @@ typedef struct {
     BF_Block *next_block;
 } HP_block_info;
 
+/* Δρομέας σάρωσης του αρχείου σωρού, από την HP_ScanOpen */
+typedef struct {
+    HP_info *info;
+    Record_Predicate predicate;
+    int filtered;            /* 0 όταν επιστρέφονται όλες οι εγγραφές */
+    int last;                /* το τελευταίο block κατά το άνοιγμα */
+    int block_num;           /* το block που είναι καρφιτσωμένο, 0 αν κανένα */
+    int next_record;         /* η επόμενη εγγραφή του block που εξετάζεται */
+    int prefetched;          /* το τελευταίο block που ζητήθηκε από πριν */
+    BF_BlockStorage storage;
+    BF_Block *block;
+    unsigned long long matches[HP_SCAN_WORDS];  /* οι εγγραφές του block
+                                                   PAX που ικανοποιούν τη συνθήκη */
+    Record current;          /* η εγγραφή PAX ή DICT που επιστράφηκε τελευταία */
+    unsigned char accept[HP_DICT_SIZE]; /* αν κάθε κωδικός της στήλης της
+                                           συνθήκης την ικανοποιεί */
+    int accepted;            /* οι κωδικοί που έχουν ελεγχθεί στο accept */
+} HP_Scan;
+
 
 /*Η συνάρτηση HP_CreateFile χρησιμοποιείται για τη δημιουργία και
 κατάλληλη αρχικοποίηση ενός άδειου αρχείου σωρού με όνομα fileName.
@@ -25,14 +98,56 @@ typedef struct {
 int HP_CreateFile(
     char *fileName /*όνομα αρχείου*/);
 
+/*Η συνάρτηση HP_CreateFileLayout λειτουργεί όπως η HP_CreateFile, αλλά
+τα block του αρχείου έχουν τη διάταξη layout. Με HP_LAYOUT_PAX τα id, τα
+ονόματα, τα επώνυμα και οι πόλεις κάθε block αποθηκεύονται ως χωριστές
+συνεχείς στήλες σταθερού πλάτους, ώστε η σάρωση με συνθήκη να συγκρίνει
+μια ολόκληρη στήλη με λίγες εντολές AVX2/SSE. Με HP_LAYOUT_DICT κάθε
+εγγραφή γίνεται 8 byte, το id και ένα byte κωδικού για κάθε συμβολοσειρά,
+και οι τιμές των συμβολοσειρών κρατιούνται μία φορά στα λεξικά του αρχείου
+fileName.dict. Κάθε στήλη δέχεται ως HP_DICT_SIZE διαφορετικές τιμές, μετά
+οι εισαγωγές νέων τιμών επιστρέφουν -1. Οι σαρώσεις συγκρίνουν κωδικούς και
+φτιάχνουν ολόκληρη την εγγραφή μόνο όταν την επιστρέφουν. Με
+HP_LAYOUT_SLOTTED κάθε block ξεκινά με κατάλογο θέσεων και οι εγγραφές
+αποθηκεύονται από το τέλος του προς τα πίσω, με κάθε συμβολοσειρά ως ένα
+byte μήκους και τους χαρακτήρες της. Έτσι κάθε εγγραφή πιάνει μόνο το
+πραγματικό της μέγεθος. Οι υπόλοιπες συναρτήσεις δουλεύουν το ίδιο με όλες
+τις διατάξεις.*/
+int HP_CreateFileLayout(
+    char *fileName, /*όνομα αρχείου*/
+    HP_Layout layout /*διάταξη των block*/);
+
+/* Η συνάρτηση HP_RemoveFile διαγράφει το αρχείο σωρού fileName μαζί με τα
+βοηθητικά αρχεία του, τον χάρτη ζωνών fileName.zm και τα λεξικά
+fileName.dict, όσα υπάρχουν. Σε περίπτωση που διαγραφεί το αρχείο
+επιστρέφεται 0, ενώ σε διαφορετική περίπτωση -1.*/
+int HP_RemoveFile(
+    char *fileName /*όνομα αρχείου*/);
+
 /* Η συνάρτηση HP_OpenFile ανοίγει το αρχείο με όνομα filename και
 διαβάζει από το πρώτο μπλοκ την πληροφορία που αφορά το αρχείο σωρού.
 Κατόπιν, ενημερώνεται μια δομή που κρατάτε όσες πληροφορίες κρίνονται
 αναγκαίες για το αρχείο αυτό προκειμένου να μπορείτε να επεξεργαστείτε
 στη συνέχεια τις εγγραφές του.
+Φορτώνεται επίσης ο χάρτης ζωνών από το αρχείο fileName.zm, δηλαδή το
+μικρότερο και το μεγαλύτερο id κάθε block. Οι εισαγωγές τον ενημερώνουν,
+η HP_CloseFile τον γράφει πίσω αν άλλαξε, και οι σαρώσεις με συνθήκη στο
+id δεν διαβάζουν τα block που δεν μπορεί να περιέχουν ταίρι. Ο χάρτης
+κρατάει την ταυτότητα του αρχείου και το τελευταίο του block. Αν λείπει ή
+δεν αντιστοιχεί στο αρχείο, ξαναχτίζεται από τα block του. Ένα άνοιγμα
+χωρίς εισαγωγές δεν δημιουργεί το fileName.zm.
 */
 HP_info* HP_OpenFile( char *fileName /* όνομα αρχείου */ );
 
+/* Η συνάρτηση HP_UseZoneMap ορίζει αν οι σαρώσεις του αρχείου παραλείπουν
+block με τον χάρτη ζωνών (use 1, η προεπιλογή) ή διαβάζουν όλα τα block
+(use 0), π.χ. για να μετρηθεί μόνο ο έλεγχος της συνθήκης. Ο χάρτης
+ενημερώνεται κανονικά και στις δύο περιπτώσεις. Επιστρέφει 0.
+*/
+int HP_UseZoneMap(
+    HP_info* header_info, /* επικεφαλίδα του αρχείου*/
+    int use /* 1 για να χρησιμοποιείται ο χάρτης, 0 αλλιώς */);
+
 
 
 /* Η συνάρτηση HP_CloseFile κλείνει το αρχείο που προσδιορίζεται
@@ -55,6 +170,84 @@ int HP_InsertEntry(
     HP_info* header_info, /* επικεφαλίδα του αρχείου*/
     Record record /* δομή που προσδιορίζει την εγγραφή */ );
 
+/* Η συνάρτηση HP_BulkInsert εισάγει με μία κλήση τις n εγγραφές του πίνακα
+records στο τέλος του αρχείου σωρού. Συμπληρώνει πρώτα το τελευταίο block
+και μετά γεμίζει ολόκληρα block, που δεσμεύονται κατά ομάδες με την
+BF_AllocateBlocks, ενημερώνοντας το πλήθος εγγραφών κάθε block μία φορά.
+Σε περίπτωση που εκτελεστεί επιτυχώς, επιστρέφεται ο αριθμός του
+τελευταίου block, ενώ αν είναι ανοιχτός δρομέας προσθήκης ή συμβεί
+σφάλμα -1.
+*/
+int HP_BulkInsert(
+    HP_info* header_info, /* επικεφαλίδα του αρχείου*/
+    const Record *records, /* οι εγγραφές προς εισαγωγή */
+    size_t n /* το πλήθος των εγγραφών */);
+
+/* Η συνάρτηση HP_BeginAppend ανοίγει έναν δρομέα προσθήκης εγγραφών στο
+τέλος του αρχείου σωρού. Ο δρομέας κρατάει καρφιτσωμένο μόνο το τελευταίο
+block, ώστε η HP_Append να γράφει τις εγγραφές χωρίς να ζητάει κάθε φορά
+το block από το επίπεδο BF. Σε περίπτωση που εκτελεστεί επιτυχώς,
+επιστρέφεται 0, ενώ αν υπάρχει ήδη ανοιχτός δρομέας ή συμβεί σφάλμα -1.
+*/
+int HP_BeginAppend(
+    HP_info* header_info /* επικεφαλίδα του αρχείου*/);
+
+/* Η συνάρτηση HP_Append προσθέτει την εγγραφή record στο τελευταίο block.
+Όταν αυτό γεμίσει (MAX_REC εγγραφές) γίνεται dirty μία φορά, ξεκαρφιτσώνεται
+και ο δρομέας περνάει σε ένα νέο block. Επιστρέφει τον αριθμό του block
+της εγγραφής, ή -1 αν δεν υπάρχει ανοιχτός δρομέας ή συμβεί σφάλμα.
+*/
+int HP_Append(
+    HP_info* header_info, /* επικεφαλίδα του αρχείου*/
+    const Record *record /* η εγγραφή που προστίθεται */);
+
+/* Η συνάρτηση HP_EndAppend κλείνει τον δρομέα προσθήκης και ξεκαρφιτσώνει
+το τελευταίο block. Η HP_CloseFile την καλεί αν ο δρομέας είναι ακόμα
+ανοιχτός. Σε περίπτωση που εκτελεστεί επιτυχώς, επιστρέφεται 0, ενώ σε
+διαφορετική περίπτωση -1.
+*/
+int HP_EndAppend(
+    HP_info* header_info /* επικεφαλίδα του αρχείου*/);
+
+/* Η συνάρτηση HP_ScanOpen ανοίγει έναν δρομέα που διατρέχει τις εγγραφές
+του αρχείου σωρού με τη σειρά των block. Αν το predicate δεν είναι NULL
+επιστρέφονται μόνο οι εγγραφές που το ικανοποιούν, και η συνθήκη ελέγχεται
+μέσα στο block χωρίς να αντιγραφούν οι υπόλοιπες. Σε περίπτωση σφάλματος
+επιστρέφεται NULL.
+*/
+HP_Scan* HP_ScanOpen(
+    HP_info* header_info, /* επικεφαλίδα του αρχείου*/
+    const Record_Predicate *predicate /* συνθήκη επιλογής ή NULL */);
+
+/* Η συνάρτηση HP_ScanNext επιστρέφει δείκτη στην επόμενη εγγραφή που
+ικανοποιεί τη συνθήκη, μέσα στο block που κρατάει καρφιτσωμένο ο δρομέας,
+χωρίς αντιγραφή. Σε αρχείο PAX η εγγραφή συναρμολογείται μέσα στον δρομέα,
+μόνο αν ικανοποιεί τη συνθήκη. Ο δείκτης ισχύει μέχρι την επόμενη κλήση της HP_ScanNext
+ή την HP_ScanClose. Όταν δεν υπάρχουν άλλες εγγραφές ή συμβεί σφάλμα
+επιστρέφεται NULL.
+*/
+const Record* HP_ScanNext(HP_Scan* scan);
+
+/* Η συνάρτηση HP_ScanClose ξεκαρφιτσώνει το block του δρομέα και
+αποδεσμεύει τη μνήμη του. Σε περίπτωση που εκτελεστεί επιτυχώς,
+επιστρέφεται 0, ενώ σε διαφορετική περίπτωση -1.
+*/
+int HP_ScanClose(HP_Scan* scan);
+
+/* Η συνάρτηση HP_ParallelScan σαρώνει το αρχείο σωρού με threads νήματα
+(με 0 όσα και οι πυρήνες). Τα block 1 έως last μοιράζονται σε ομάδες
+διαδοχικών block, που κάθε νήμα παίρνει μία-μία από έναν κοινό ατομικό
+μετρητή, ελέγχοντας τη συνθήκη predicate (NULL για όλες τις εγγραφές). Στο
+τέλος οι εγγραφές που βρέθηκαν ενώνονται με τη σειρά του αρχείου σε έναν
+πίνακα *matches, τον οποίο αποδεσμεύει με free όποιος καλεί τη συνάρτηση.
+Επιστρέφει το πλήθος των εγγραφών του πίνακα ή -1 σε περίπτωση σφάλματος.
+*/
+int HP_ParallelScan(
+    HP_info* header_info, /* επικεφαλίδα του αρχείου*/
+    const Record_Predicate *predicate, /* συνθήκη επιλογής ή NULL */
+    int threads, /* πλήθος νημάτων */
+    Record **matches /* ο πίνακας με τις εγγραφές που βρέθηκαν */);
+
 /*Η συνάρτηση αυτή χρησιμοποιείται για την εκτύπωση όλων των εγγραφών
 που υπάρχουν στο αρχείο κατακερματισμού οι οποίες έχουν τιμή στο
 πεδίο-κλειδί ίση με value. Η πρώτη δομή δίνει πληροφορία για το αρχείο
@@ -1,6 +1,7 @@
 #ifndef HT_TABLE_H
 #define HT_TABLE_H
 #include <record.h>
+#include "bf.h"
 
 /*αποθηκεύονται πληροφορίες σε σχέση με το  hash bucket*/
 typedef struct {
@@ -8,10 +9,51 @@ typedef struct {
     int last;
 } HT_table;
 
+/* Ο τρόπος που μεγαλώνει το αρχείο κατακερματισμού */
+typedef enum HT_Mode {
+    HT_MODE_STATIC,  /* σταθερό πλήθος κάδων, οι αλυσίδες μακραίνουν */
+    HT_MODE_LINEAR   /* γραμμικός κατακερματισμός, ένας κάδος χωρίζεται κάθε
+                        φορά που το φορτίο ξεπερνά το HT_LINEAR_LOAD */
+} HT_Mode;
+
+/* Το ποσοστό των θέσεων εγγραφών των κάδων που γεμίζει πριν από έναν χωρισμό */
+#define HT_LINEAR_LOAD 80
+
+/* Η συνάρτηση κατακερματισμού, αποθηκεύεται στην επικεφαλίδα του αρχείου
+   (HT) ή του ευρετηρίου (SHT). Ο κάδος είναι η τιμή της modulo το πλήθος
+   των κάδων */
+typedef enum HT_Hash {
+    HT_HASH_MODULO,     /* το ίδιο το id, ή τα χαρακτήρες του ονόματος ως
+                           αριθμός με βάση 256, όπως πριν */
+    HT_HASH_FIBONACCI,  /* πολλαπλασιαστικός με 2^64/φ (Fibonacci) */
+    HT_HASH_WYHASH      /* ανάμειξη με γινόμενα 128 bit τύπου wyhash,
+                           8 χαρακτήρες τη φορά για τα ονόματα */
+} HT_Hash;
+
 typedef struct {
     int fileDesc;           /* αναγνωριστικός αριθμός ανοίγματος αρχείου από το επίπεδο block */
     int numBuckets;    /* το πλήθος των “κάδων” του αρχείου κατακερματισμού */ 
     BF_Block *first_block;
+    BF_BlockStorage handle; /* το block της HT_InsertEntry, ώστε να μη
+                               δεσμεύεται μνήμη σε κάθε εισαγωγή */
+    int mode;               /* HT_Mode του αρχείου */
+    int initialBuckets;     /* γραμμικός: οι κάδοι κατά τη δημιουργία */
+    int level;              /* γραμμικός: ο γύρος χωρισμών, με
+                               initialBuckets*2^level κάδους στην αρχή του */
+    int split;              /* γραμμικός: ο επόμενος κάδος που χωρίζεται */
+    int splits;             /* γραμμικός: πόσοι χωρισμοί έγιναν */
+    int records;            /* γραμμικός: το πλήθος των εγγραφών */
+    int dirFirst;           /* το πρώτο από τα συνεχόμενα block του καταλόγου
+                               των κάδων, που διευθετείται με τον αριθμό κάδου */
+    int dirBlocks;          /* πόσα block πιάνει ο κατάλογος */
+    HT_table *directory;    /* ο κατάλογος στη μνήμη όσο το αρχείο είναι ανοιχτό */
+    unsigned char *dirDirty; /* ποια block του καταλόγου άλλαξαν από το
+                                τελευταίο HT_Checkpoint */
+    int hashFunction;       /* HT_Hash του αρχείου */
+    int freeBlock;          /* γραμμικός: το πρώτο από τα block που άφησαν
+                               οι χωρισμοί και οι μεταφορές του καταλόγου,
+                               συνδεδεμένα με το next, ή -1 */
+    int freeBlocks;         /* γραμμικός: πόσα block είναι ελεύθερα */
 } HT_info;
 
 /*αποθηκεύονται πληροφορίες σε σχέση με το block*/
@@ -32,12 +74,43 @@ typedef struct {
 και κατάλληλη αρχικοποίηση ενός άδειου αρχείου κατακερματισμού
 με όνομα fileName. Έχει σαν παραμέτρους εισόδου το όνομα του
 αρχείου στο οποίο θα κτιστεί ο σωρός και των αριθμό των κάδων
-της συνάρτησης κατακερματισμού. Σε περίπτωση που εκτελεστεί
+της συνάρτησης κατακερματισμού. Ο κατάλογος των κάδων πιάνει όσα
+block χρειάζονται μετά το block 0, οπότε το πλήθος των κάδων δεν
+περιορίζεται από το μέγεθος του block. Σε περίπτωση που εκτελεστεί
 επιτυχώς, επιστρέφεται 0, ενώ σε διαφορετική περίπτωση -1.*/
 int HT_CreateFile(
     char *fileName, 	/*όνομα αρχείου*/
     int buckets         /*αριθμός από buckets*/);
 
+/*Η συνάρτηση HT_CreateFileLinear δημιουργεί ένα αρχείο γραμμικού
+κατακερματισμού με buckets αρχικούς κάδους. Κάθε κάδος είναι αλυσίδα block
+συνδεδεμένων με το πεδίο next του HT_block_info. Όταν οι εγγραφές ξεπεράσουν
+το HT_LINEAR_LOAD τοις εκατό των θέσεων, η εισαγωγή χωρίζει έναν μόνο
+κάδο, αυτόν που δείχνει το split, ώστε να μην ξαναμοιράζεται ποτέ όλο το
+αρχείο μαζί. Ο χωρισμός γράφει πρώτα τις δύο νέες αλυσίδες και μετά
+ελευθερώνει τα block της παλιάς, που τα παίρνουν οι επόμενες αλυσίδες.
+Όταν ο κατάλογος γεμίσει, μεταφέρεται σε διπλάσια σειρά block και η παλιά
+σειρά γίνεται κι αυτή ελεύθερα block. Οι υπόλοιπες συναρτήσεις HT_
+δουλεύουν και με αυτά τα αρχεία, όμως οι χωρισμοί μετακινούν εγγραφές,
+οπότε ένα δευτερεύον ευρετήριο SHT δεν μπορεί να δείχνει σε αυτά. Σε
+περίπτωση που εκτελεστεί επιτυχώς, επιστρέφεται 0, ενώ σε διαφορετική
+περίπτωση -1.*/
+int HT_CreateFileLinear(
+    char *fileName,     /*όνομα αρχείου*/
+    int buckets         /*αρχικός αριθμός από buckets*/);
+
+/*Η συνάρτηση HT_CreateFileHash δημιουργεί αρχείο κατακερματισμού με τρόπο
+mode (HT_MODE_STATIC όπως η HT_CreateFile, HT_MODE_LINEAR όπως η
+HT_CreateFileLinear) και συνάρτηση κατακερματισμού function για τα id. Οι
+HT_CreateFile και HT_CreateFileLinear χρησιμοποιούν την HT_HASH_MODULO. Σε
+περίπτωση που εκτελεστεί επιτυχώς, επιστρέφεται 0, ενώ σε διαφορετική
+περίπτωση -1.*/
+int HT_CreateFileHash(
+    char *fileName,     /*όνομα αρχείου*/
+    int buckets,        /*(αρχικός) αριθμός από buckets*/
+    HT_Mode mode,       /*τρόπος που μεγαλώνει το αρχείο*/
+    HT_Hash function    /*συνάρτηση κατακερματισμού*/);
+
 /*Η συνάρτηση HT_OpenFile ανοίγει το αρχείο με όνομα filename
 και διαβάζει από το πρώτο μπλοκ την πληροφορία που αφορά το
 αρχείο κατακερματισμού. Κατόπιν, ενημερώνεται μια δομή που κρατάτε
@@ -46,9 +119,23 @@ int HT_CreateFile(
 ενημερωθεί κατάλληλα η δομή πληροφοριών του αρχείου, την επιστρέφετε.
 Σε περίπτωση που συμβεί οποιοδήποτε σφάλμα, επιστρέφεται τιμή NULL.
 Αν το αρχείο που δόθηκε για άνοιγμα δεν αφορά αρχείο κατακερματισμού,
-τότε αυτό επίσης θεωρείται σφάλμα. */
+τότε αυτό επίσης θεωρείται σφάλμα. Ο κατάλογος των κάδων διαβάζεται μία
+φορά στη μνήμη, και οι εισαγωγές και οι αναζητήσεις δεν ζητούν τα block του.*/
 HT_info* HT_OpenFile(char *fileName /*όνομα αρχείου*/);
 
+/*Η συνάρτηση HT_OpenFileMode λειτουργεί όπως η HT_OpenFile, αλλά ανοίγει
+το αρχείο στο επίπεδο block με τον τρόπο mode. Με BF_OPEN_MMAP οι αναζητήσεις
+της HT_GetAllEntries διαβάζουν τα block χωρίς αντιγραφή στην ενδιάμεση μνήμη.*/
+HT_info* HT_OpenFileMode(char *fileName, /*όνομα αρχείου*/
+    BF_OpenMode mode /*τρόπος ανοίγματος στο επίπεδο block*/);
+
+/*Η συνάρτηση HT_Checkpoint γράφει την επικεφαλίδα και τα block του
+καταλόγου που άλλαξαν από το προηγούμενο HT_Checkpoint στο επίπεδο block.
+Χωρίς αυτήν, οι αλλαγές του καταλόγου γράφονται μόνο στην HT_CloseFile.
+Σε περίπτωση που εκτελεστεί επιτυχώς, επιστρέφεται 0, ενώ σε διαφορετική
+περίπτωση -1.*/
+int HT_Checkpoint(HT_info* header_info /*επικεφαλίδα του αρχείου*/);
+
 /*Η συνάρτηση HT_CloseFile κλείνει το αρχείο που προσδιορίζεται μέσα
 στη δομή header_info. Σε περίπτωση που εκτελεστεί επιτυχώς, επιστρέφεται
 0, ενώ σε διαφορετική περίπτωση -1. Η συνάρτηση είναι υπεύθυνη και για την
@@ -75,6 +162,16 @@ int HT_GetAllEntries(HT_info* header_info, /*επικεφαλίδα του αρ
 	void *value /*τιμή του πεδίου-κλειδιού προς αναζήτηση*/);
 
 
+/*Η συνάρτηση HashStatistics τυπώνει το πλήθος των block, τις εγγραφές ανά
+κάδο και τα block υπερχείλισης του αρχείου fileName. Για αρχείο γραμμικού
+κατακερματισμού τυπώνει επίσης το επίπεδο, τον δείκτη χωρισμού, το πλήθος
+των χωρισμών και το φορτίο. Τυπώνει ακόμη τη συνάρτηση κατακερματισμού και
+πόσο απέχουν οι εγγραφές ανά κάδο από την ομοιόμορφη κατανομή: το χ^2 ανά
+βαθμό ελευθερίας (κοντά στο 1 για καλή συνάρτηση, πολύ μεγαλύτερο όταν οι
+εγγραφές μαζεύονται σε λίγους κάδους) και τον λόγο μέγιστου προς μέσο.
+Στο πλήθος των block ενός γραμμικού αρχείου μετράνε και τα ελεύθερα.
+Διαβάζει το αρχείο από το επίπεδο block, οπότε για ανοιχτό αρχείο
+χρειάζεται πρώτα HT_Checkpoint.*/
 int HashStatistics(char* fileName);
 
 #endif // HT_FILE_H
@@ -8,6 +8,15 @@ typedef enum Record_Attribute {
   CITY
 } Record_Attribute;
 
+typedef enum Record_Compare {
+  EQUAL,
+  NOT_EQUAL,
+  LESS,
+  LESS_EQUAL,
+  GREATER,
+  GREATER_EQUAL
+} Record_Compare;
+
 typedef struct Record {
   char record[15];
 	int id;
@@ -16,6 +25,15 @@ typedef struct Record {
 	char city[20];
 } Record;
 
+/* Συνθήκη επιλογής εγγραφών: το πεδίο attribute συγκρίνεται με compare
+   με το id, αν attribute == ID, ή με τη συμβολοσειρά value */
+typedef struct Record_Predicate {
+  Record_Attribute attribute;
+  Record_Compare compare;
+  int id;
+  const char *value;
+} Record_Predicate;
+
 Record randomRecord();
 
 void printRecord(Record record);
@@ -15,6 +15,15 @@ typedef struct {
     char *fileName;
     int numBuckets;
     BF_Block *first_block;
+    BF_BlockStorage handle; /* το block της SHT_SecondaryInsertEntry, ώστε να
+                               μη δεσμεύεται μνήμη σε κάθε εισαγωγή */
+    int dirFirst;           /* το πρώτο από τα συνεχόμενα block του καταλόγου
+                               των κάδων, που διευθετείται με τον αριθμό κάδου */
+    int dirBlocks;          /* πόσα block πιάνει ο κατάλογος */
+    SHT_table *directory;   /* ο κατάλογος στη μνήμη όσο το ευρετήριο είναι ανοιχτό */
+    unsigned char *dirDirty; /* ποια block του καταλόγου άλλαξαν από το
+                                τελευταίο SHT_Checkpoint */
+    int hashFunction;       /* HT_Hash του ευρετηρίου, για τα ονόματα */
 } SHT_info;
 
 
@@ -30,7 +39,8 @@ typedef struct{
 
 /*Η συνάρτηση SHT_CreateSecondaryIndex χρησιμοποιείται για τη δημιουργία
 και κατάλληλη αρχικοποίηση ενός αρχείου δευτερεύοντος κατακερματισμού με
-όνομα sfileName για το αρχείο πρωτεύοντος κατακερματισμού fileName. Σε
+όνομα sfileName για το αρχείο πρωτεύοντος κατακερματισμού fileName. Ο
+κατάλογος των κάδων πιάνει όσα block χρειάζονται μετά το block 0. Σε
 περίπτωση που εκτελεστεί επιτυχώς, επιστρέφεται 0, ενώ σε διαφορετική
 περίπτωση -1.*/
 int SHT_CreateSecondaryIndex(
@@ -40,12 +50,36 @@ int SHT_CreateSecondaryIndex(
 
 
 
+/*Η συνάρτηση SHT_CreateSecondaryIndexHash λειτουργεί όπως η
+SHT_CreateSecondaryIndex, με συνάρτηση κατακερματισμού function για τα
+ονόματα αντί για την HT_HASH_MODULO. Σε περίπτωση που εκτελεστεί επιτυχώς,
+επιστρέφεται 0, ενώ σε διαφορετική περίπτωση -1.*/
+int SHT_CreateSecondaryIndexHash(
+    char *sfileName, /* όνομα αρχείου δευτερεύοντος ευρετηρίου*/
+    int buckets, /* αριθμός κάδων κατακερματισμού*/
+    char* fileName, /* όνομα αρχείου πρωτεύοντος ευρετηρίου*/
+    HT_Hash function /* συνάρτηση κατακερματισμού*/);
+
 /* Η συνάρτηση SHT_OpenSecondaryIndex ανοίγει το αρχείο με όνομα sfileName
 και διαβάζει από το πρώτο μπλοκ την πληροφορία που αφορά το δευτερεύον
-ευρετήριο κατακερματισμού.*/
+ευρετήριο κατακερματισμού. Ο κατάλογος των κάδων διαβάζεται μία φορά στη
+μνήμη.*/
 SHT_info* SHT_OpenSecondaryIndex(
     char *sfileName /* όνομα αρχείου δευτερεύοντος ευρετηρίου */);
 
+/* Η συνάρτηση SHT_OpenSecondaryIndexMode λειτουργεί όπως η SHT_OpenSecondaryIndex,
+αλλά ανοίγει το αρχείο στο επίπεδο block με τον τρόπο mode (π.χ. BF_OPEN_MMAP
+για ευρετήρια που έχουν ήδη χτιστεί και κυρίως διαβάζονται).*/
+SHT_info* SHT_OpenSecondaryIndexMode(
+    char *sfileName, /* όνομα αρχείου δευτερεύοντος ευρετηρίου */
+    BF_OpenMode mode /* τρόπος ανοίγματος στο επίπεδο block */);
+
+/*Η συνάρτηση SHT_Checkpoint γράφει τα block του καταλόγου που άλλαξαν από
+το προηγούμενο SHT_Checkpoint στο επίπεδο block. Χωρίς αυτήν, οι αλλαγές
+του καταλόγου γράφονται μόνο στην SHT_CloseSecondaryIndex. Σε περίπτωση που
+εκτελεστεί επιτυχώς, επιστρέφεται 0, ενώ σε διαφορετική περίπτωση -1.*/
+int SHT_Checkpoint(SHT_info* header_info /* επικεφαλίδα του δευτερεύοντος ευρετηρίου*/);
+
 /*Η συνάρτηση SHT_CloseSecondaryIndex κλείνει το αρχείο που προσδιορίζεται
 μέσα στη δομή header_info. Σε περίπτωση που εκτελεστεί επιτυχώς, επιστρέφεται
 0, ενώ σε διαφορετική περίπτωση -1. Η συνάρτηση είναι υπεύθυνη και για την
@@ -79,6 +113,12 @@ int SHT_SecondaryGetAllEntries(
     SHT_info* header_info, /* επικεφαλίδα του αρχείου δευτερεύοντος ευρετηρίου*/
     char* name /* το όνομα στο οποίο γίνεται αναζήτηση */);
 
+/*Η συνάρτηση SHashStatistics τυπώνει το πλήθος των block, τις εγγραφές ανά
+κάδο και τα block υπερχείλισης του ευρετηρίου sfileName. Διαβάζει το αρχείο
+από το επίπεδο block, οπότε για ανοιχτό ευρετήριο χρειάζεται πρώτα
+SHT_Checkpoint. Όπως η HashStatistics, τυπώνει και τη συνάρτηση
+κατακερματισμού με το χ^2 ανά βαθμό ελευθερίας και τον λόγο μέγιστου προς
+μέσο.*/
 int SHashStatistics(char* sfileName);
 
 
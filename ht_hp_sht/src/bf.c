@@ -0,0 +1,1763 @@
+#define _GNU_SOURCE      /* fallocate, O_DIRECT, statx */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <errno.h>
+
+#if !defined(BF_NO_IO_URING) && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define BF_HAVE_IO_URING
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "bf.h"
+
+#define BF_IO_BATCH 64   /* most blocks in one submission, also the size of the ring */
+#define BF_MAX_SHARDS 16     /* most partitions of the pool, each with its own latch */
+#define BF_SHARD_FRAMES 64   /* one partition per this many frames, small pools keep one */
+#define BF_POOL_ALIGN 4096   /* alignment of the pool, enough for O_DIRECT on common devices */
+#define BF_HUGE_PAGE_SIZE (2 << 20)  /* regions this large are backed by huge pages */
+
+/* The handle the upper layers keep for a block they have asked for */
+struct BF_Block {
+    int file_desc;   /* file_desc the block was requested through, -1 if none */
+    int block_num;
+    int frame;       /* frame of the buffer pool that holds the block, -1 if none */
+    int mapped_file; /* file whose mapping holds the block, -1 if none */
+    char *data;
+};
+
+/* An open file on disk. Several file_desc may point to the same file,
+   in that case they share the same cached blocks */
+typedef struct {
+    int used;
+    int fd;              /* descriptor of the operating system */
+    dev_t dev;
+    ino_t ino;
+    int block_count;
+    int open_count;      /* how many file_desc point to this file */
+    int direct;          /* opened with O_DIRECT, the page cache is bypassed */
+    char *map;           /* BF_OPEN_MMAP: the blocks that existed at open, NULL otherwise */
+    int map_blocks;
+    int map_pins;        /* pins on blocks read straight from the mapping, atomic */
+    BF_Stats stats;      /* I/O counters of the file, atomic */
+} BF_File;
+
+/* A frame of the buffer pool. Everything but pin_count is guarded by the
+   latch of the partition the frame belongs to */
+typedef struct {
+    int file;            /* index in files[], -1 when the frame is free */
+    int block_num;
+    int shard;           /* partition the frame belongs to */
+    int pin_count;       /* atomic: raised under the latch, dropped without it */
+    int loading;         /* the block is being read in with the latch released */
+    int dirty;
+    int hash_next;       /* next frame in the same page table bucket */
+    int queue;           /* list the frame belongs to, -1 if none */
+    int prev;            /* head of a list is the most recently inserted */
+    int next;
+    int ref;             /* CLOCK reference bit */
+    int prefetched;      /* read by BF_Prefetch and not asked for since */
+    unsigned long hist[BF_LRU_K];   /* LRU-K: times of the last K references, latest first */
+    char *data;
+} BF_Frame;
+
+/* A doubly linked list of frames */
+typedef struct {
+    int head;
+    int tail;
+    int size;
+} BF_List;
+
+#define MAIN_LIST 0      /* recency list of LRU/MRU, Am of 2Q */
+#define A1IN_LIST 1      /* 2Q: blocks referenced only once since they were loaded */
+
+/* A partition of the pool. A block always lives in the partition its
+   (file, block_num) hashes to, so threads asking for blocks of different
+   partitions never wait for each other. Each partition runs the
+   replacement policy over its own frames */
+typedef struct {
+    pthread_mutex_t latch;
+    int first;                /* frames [first, first + size) belong to the partition */
+    int size;
+    int free_frames;          /* list of free frames linked with next */
+    BF_List lists[2];
+    int clock_hand;
+    unsigned long clock_tick;
+
+    /* Page table: (file, block_num) -> frame, chained through hash_next */
+    int *page_table;
+    int page_table_size;
+
+    /* 2Q: ring of recently evicted A1in blocks (A1out), with its own hash index */
+    int *ghost_file;
+    int *ghost_block;
+    int *ghost_next;
+    int *ghost_table;
+    int ghost_size;
+    int ghost_pos;
+
+    BF_Stats stats;           /* gets, hits, reads and evictions of the partition */
+    BF_Stats *file_stats;     /* the same for each entry of files[] */
+} __attribute__((aligned(64))) BF_Shard;
+
+static int bf_active = 0;
+static ReplacementAlgorithm bf_repl_alg = LRU;
+static int bf_block_size = BF_DEFAULT_BLOCK_SIZE;
+static int bf_buffer_size = BF_DEFAULT_BUFFER_SIZE;
+
+/* Memory of the pool or of the frame array, and the pages that back it */
+typedef struct {
+    void *addr;
+    size_t bytes;         /* length of the mapping, 0 when it came from posix_memalign */
+    BF_PoolPages pages;
+} BF_Region;
+
+static BF_PoolPages bf_pool_pages = BF_PAGES_HUGETLB;   /* what BF_Init tries first */
+static BF_Region pool_region;
+static BF_Region frames_region;
+
+static char *pool = NULL;
+static BF_Frame *frames = NULL;
+static BF_Shard shards[BF_MAX_SHARDS];
+static int shard_count = 0;
+
+/* Counters of the I/O paths, which do not run under a single partition latch.
+   They are kept for all files here and for each file in BF_File.stats */
+static BF_Stats io_stats;
+#define IO_STAT(file, field, n)                                                  \
+    do {                                                                         \
+        __atomic_fetch_add(&io_stats.field, (n), __ATOMIC_RELAXED);              \
+        if ((file) != -1) {                                                      \
+            __atomic_fetch_add(&files[file].stats.field, (n), __ATOMIC_RELAXED); \
+        }                                                                        \
+    } while (0)
+
+/* Counters of a partition, for all files and for the file of the block */
+#define SHARD_STAT(s, file, field) ((s)->stats.field++, (s)->file_stats[file].field++)
+
+/* Guards files[] and open_files[] while files are opened and closed */
+static pthread_mutex_t files_latch = PTHREAD_MUTEX_INITIALIZER;
+static BF_File files[BF_MAX_OPEN_FILES];
+static int open_files[BF_MAX_OPEN_FILES];   /* file_desc -> index in files[], -1 if closed */
+
+
+static unsigned int block_hash(int file, int block_num) {
+    return (unsigned int)block_num * 2654435761u ^ (unsigned int)file * 40503u;
+}
+
+/* The top bits of the hash pick the partition, the low ones the bucket in it */
+static BF_Shard *shard_of(int file, int block_num) {
+    return &shards[(block_hash(file, block_num) >> 28) & (shard_count - 1)];
+}
+
+static int page_hash(BF_Shard *s, int file, int block_num) {
+    return block_hash(file, block_num) & (s->page_table_size - 1);
+}
+
+static void lock_all() {
+    for (int i = 0; i < shard_count; i++) {
+        pthread_mutex_lock(&shards[i].latch);
+    }
+}
+
+static void unlock_all() {
+    for (int i = shard_count - 1; i >= 0; i--) {
+        pthread_mutex_unlock(&shards[i].latch);
+    }
+}
+
+static int pinned(int f) {
+    return __atomic_load_n(&frames[f].pin_count, __ATOMIC_ACQUIRE) > 0;
+}
+
+static void pin(int f) {
+    __atomic_fetch_add(&frames[f].pin_count, 1, __ATOMIC_ACQUIRE);
+}
+
+/* Drop a pin count without going below zero */
+static void unpin(int *count) {
+    int pins = __atomic_load_n(count, __ATOMIC_RELAXED);
+    while (pins > 0 && !__atomic_compare_exchange_n(count, &pins, pins - 1, 0,
+                                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+}
+
+static int is_power_of_two(int x) {
+    return x > 0 && (x & (x - 1)) == 0;
+}
+
+
+/* Frame lists */
+
+static void list_remove(BF_Shard *s, int f) {
+    BF_Frame *frame = &frames[f];
+    BF_List *list = &s->lists[frame->queue];
+    if (frame->prev != -1) {
+        frames[frame->prev].next = frame->next;
+    } else {
+        list->head = frame->next;
+    }
+    if (frame->next != -1) {
+        frames[frame->next].prev = frame->prev;
+    } else {
+        list->tail = frame->prev;
+    }
+    list->size--;
+    frame->prev = frame->next = -1;
+    frame->queue = -1;
+}
+
+static void list_push_front(BF_Shard *s, int queue, int f) {
+    BF_List *list = &s->lists[queue];
+    frames[f].queue = queue;
+    frames[f].prev = -1;
+    frames[f].next = list->head;
+    if (list->head != -1) {
+        frames[list->head].prev = f;
+    }
+    list->head = f;
+    if (list->tail == -1) {
+        list->tail = f;
+    }
+    list->size++;
+}
+
+/* First unpinned frame of a list, starting from the tail (oldest) or the head */
+static int list_unpinned(BF_Shard *s, int queue, int from_tail) {
+    int f = from_tail ? s->lists[queue].tail : s->lists[queue].head;
+    while (f != -1 && pinned(f)) {
+        f = from_tail ? frames[f].prev : frames[f].next;
+    }
+    return f;
+}
+
+
+/* Page table */
+
+static int page_lookup(BF_Shard *s, int file, int block_num) {
+    int f = s->page_table[page_hash(s, file, block_num)];
+    while (f != -1) {
+        if (frames[f].file == file && frames[f].block_num == block_num) {
+            return f;
+        }
+        f = frames[f].hash_next;
+    }
+    return -1;
+}
+
+static void page_insert(BF_Shard *s, int f) {
+    int h = page_hash(s, frames[f].file, frames[f].block_num);
+    frames[f].hash_next = s->page_table[h];
+    s->page_table[h] = f;
+}
+
+/* A page table lookup that waits for a block another thread is reading in.
+   The latch of the partition is held, and dropped while waiting */
+static int page_lookup_loaded(BF_Shard *s, int file, int block_num) {
+    int f;
+    while ((f = page_lookup(s, file, block_num)) != -1 && frames[f].loading) {
+        pthread_mutex_unlock(&s->latch);
+        sched_yield();
+        pthread_mutex_lock(&s->latch);
+    }
+    return f;
+}
+
+static void page_remove(BF_Shard *s, int f) {
+    int *link = &s->page_table[page_hash(s, frames[f].file, frames[f].block_num)];
+    while (*link != -1) {
+        if (*link == f) {
+            *link = frames[f].hash_next;
+            break;
+        }
+        link = &frames[*link].hash_next;
+    }
+    frames[f].hash_next = -1;
+}
+
+
+/* Disk I/O */
+
+/* One block, or a run of consecutive blocks, to read or write */
+typedef struct {
+    int fd;
+    int file;            /* index in files[] the counters are charged to */
+    int write;
+    off_t offset;
+    char *data;          /* the block, when iov is NULL */
+    struct iovec *iov;   /* frames of consecutive blocks transferred with one call */
+    int blocks;          /* 1 when iov is NULL */
+    int result;          /* bytes transferred, -errno on failure */
+} BF_IORequest;
+
+#ifdef BF_HAVE_IO_URING
+
+/* The rings shared with the kernel, used without liburing */
+static struct {
+    int fd;                          /* -1 when io_uring is not available */
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+} ring = { .fd = -1 };
+
+static void uring_close() {
+    if (ring.fd == -1) {
+        return;
+    }
+    munmap(ring.sqes, ring.sqes_size);
+    if (ring.cq_ring != ring.sq_ring) {
+        munmap(ring.cq_ring, ring.cq_ring_size);
+    }
+    munmap(ring.sq_ring, ring.sq_ring_size);
+    close(ring.fd);
+    ring.fd = -1;
+}
+
+/* Set up the ring, on kernels without io_uring the BF layer keeps pread/pwrite */
+static void uring_open() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, BF_IO_BATCH, &params);
+    if (fd < 0) {
+        return;
+    }
+    ring.fd = fd;
+    ring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring.cq_ring_size > ring.sq_ring_size) {
+            ring.sq_ring_size = ring.cq_ring_size;
+        }
+        ring.cq_ring_size = ring.sq_ring_size;
+    }
+    ring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring.sq_ring = mmap(NULL, ring.sq_ring_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring.sq_ring == MAP_FAILED) {
+        close(fd);
+        ring.fd = -1;
+        return;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring.cq_ring = ring.sq_ring;
+    } else {
+        ring.cq_ring = mmap(NULL, ring.cq_ring_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring.cq_ring == MAP_FAILED) {
+            munmap(ring.sq_ring, ring.sq_ring_size);
+            close(fd);
+            ring.fd = -1;
+            return;
+        }
+    }
+    ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring.sqes == MAP_FAILED) {
+        ring.sqes_size = 0;
+        ring.sqes = NULL;
+        if (ring.cq_ring != ring.sq_ring) {
+            munmap(ring.cq_ring, ring.cq_ring_size);
+        }
+        munmap(ring.sq_ring, ring.sq_ring_size);
+        close(fd);
+        ring.fd = -1;
+        return;
+    }
+
+    char *sq = ring.sq_ring;
+    char *cq = ring.cq_ring;
+    ring.sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring.sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring.sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring.sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring.cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring.cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring.cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+}
+
+/* Submit up to BF_IO_BATCH requests with one system call and wait for all of them */
+static BF_ErrorCode uring_run(BF_IORequest *reqs, int n) {
+    unsigned tail = *ring.sq_tail;
+    for (int i = 0; i < n; i++) {
+        unsigned index = tail & *ring.sq_mask;
+        struct io_uring_sqe *sqe = &ring.sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->fd = reqs[i].fd;
+        sqe->off = reqs[i].offset;
+        if (reqs[i].iov != NULL) {
+            sqe->opcode = reqs[i].write ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe->addr = (unsigned long)reqs[i].iov;
+            sqe->len = reqs[i].blocks;
+        } else {
+            sqe->opcode = reqs[i].write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe->addr = (unsigned long)reqs[i].data;
+            sqe->len = bf_block_size;
+        }
+        sqe->user_data = i;
+        ring.sq_array[index] = index;
+        tail++;
+    }
+    __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+    /* Every request the kernel took is reaped before returning, even when a
+       call fails: the buffers of the requests belong to the caller */
+    int submitted = 0;
+    int completed = 0;
+    BF_ErrorCode code = BF_OK;
+    while (completed < n) {
+        int ret = code != BF_OK ? 0
+                : syscall(__NR_io_uring_enter, ring.fd, n - submitted, n - completed,
+                          IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            /* Take back what the kernel did not read yet and wait for the rest */
+            code = BF_ERROR;
+            __atomic_store_n(ring.sq_tail, __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE),
+                             __ATOMIC_RELEASE);
+            for (int i = submitted; i < n; i++) {
+                reqs[i].result = -EIO;
+            }
+            n = submitted;
+        } else if (ret > 0) {
+            submitted += ret;
+        }
+        if (ret >= 0 && code == BF_OK) {
+            IO_STAT(-1, io_calls, 1);
+        }
+
+        unsigned head = *ring.cq_head;
+        while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            reqs[cqe->user_data].result = cqe->res;
+            head++;
+            completed++;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+        if (code != BF_OK && completed < n) {
+            /* Without a working io_uring_enter the completions still reach the ring */
+            sched_yield();
+        }
+    }
+    return code;
+}
+
+#endif
+
+#ifdef BF_HAVE_IO_URING
+/* The ring is shared by all threads, one batch at a time goes through it */
+static pthread_mutex_t ring_latch = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* Run a batch of block reads and writes, one submission per BF_IO_BATCH
+   requests with io_uring or one pread/pwrite each without it */
+static BF_ErrorCode io_run(BF_IORequest *reqs, int n) {
+    for (int done = 0; done < n; done += BF_IO_BATCH) {
+        int count = (n - done < BF_IO_BATCH) ? n - done : BF_IO_BATCH;
+#ifdef BF_HAVE_IO_URING
+        /* A single request costs one system call either way, it does not wait for the ring */
+        if (ring.fd != -1 && count > 1) {
+            pthread_mutex_lock(&ring_latch);
+            BF_ErrorCode code = uring_run(reqs + done, count);
+            pthread_mutex_unlock(&ring_latch);
+            if (code != BF_OK) {
+                return BF_ERROR;
+            }
+            continue;
+        }
+#endif
+        for (int i = done; i < done + count; i++) {
+            BF_IORequest *req = &reqs[i];
+            ssize_t ret;
+            if (req->iov != NULL) {
+                ret = req->write ? pwritev(req->fd, req->iov, req->blocks, req->offset)
+                                 : preadv(req->fd, req->iov, req->blocks, req->offset);
+            } else {
+                ret = req->write ? pwrite(req->fd, req->data, bf_block_size, req->offset)
+                                 : pread(req->fd, req->data, bf_block_size, req->offset);
+            }
+            IO_STAT(-1, io_calls, 1);
+            req->result = ret;
+        }
+    }
+
+    BF_ErrorCode code = BF_OK;
+    for (int i = 0; i < n; i++) {
+        if (reqs[i].result > 0 && reqs[i].write) {
+            IO_STAT(reqs[i].file, bytes_written, reqs[i].result);
+        } else if (reqs[i].result > 0) {
+            IO_STAT(reqs[i].file, bytes_read, reqs[i].result);
+        }
+        if (reqs[i].result < 0
+            || (reqs[i].write && reqs[i].result != reqs[i].blocks * bf_block_size)) {
+            code = BF_ERROR;
+        } else if (!reqs[i].write && reqs[i].result < bf_block_size) {
+            /* Blocks allocated but never written back read as zeros */
+            memset(reqs[i].data + reqs[i].result, 0, bf_block_size - reqs[i].result);
+        }
+    }
+    return code;
+}
+
+static BF_ErrorCode read_block(int file, int block_num, char *data) {
+    BF_IORequest req = { files[file].fd, file, 0, (off_t)block_num * bf_block_size,
+                         data, NULL, 1, 0 };
+    return io_run(&req, 1);
+}
+
+static int compare_frames(const void *a, const void *b) {
+    const BF_Frame *x = &frames[*(const int *)a];
+    const BF_Frame *y = &frames[*(const int *)b];
+    if (x->file != y->file) {
+        return x->file - y->file;
+    }
+    return x->block_num - y->block_num;
+}
+
+/* Write back a set of dirty frames with as few calls as possible: the frames
+   are sorted by block number and every run of consecutive blocks of a file
+   goes out with one pwritev (or one io_uring entry). The caller holds the
+   latches of the partitions the frames belong to */
+static BF_ErrorCode write_frames(const int *list, int n) {
+    if (n == 0) {
+        return BF_OK;
+    }
+    int *sorted = malloc(n * sizeof(int));
+    struct iovec *iov = malloc(n * sizeof(struct iovec));
+    if (sorted == NULL || iov == NULL) {
+        free(sorted);
+        free(iov);
+        return BF_ERROR;
+    }
+    memcpy(sorted, list, n * sizeof(int));
+    qsort(sorted, n, sizeof(int), compare_frames);
+    for (int i = 0; i < n; i++) {
+        iov[i].iov_base = frames[sorted[i]].data;
+        iov[i].iov_len = bf_block_size;
+    }
+
+    BF_IORequest reqs[BF_IO_BATCH];
+    int first[BF_IO_BATCH];     /* index in sorted[] of the first frame of each request */
+    BF_ErrorCode code = BF_OK;
+
+    int i = 0;
+    while (i < n) {
+        int count = 0;
+        while (i < n && count < BF_IO_BATCH) {
+            BF_Frame *frame = &frames[sorted[i]];
+            int run = 1;
+            while (i + run < n && run < BF_IO_BATCH
+                   && frames[sorted[i + run]].file == frame->file
+                   && frames[sorted[i + run]].block_num == frame->block_num + run) {
+                run++;
+            }
+            reqs[count].fd = files[frame->file].fd;
+            reqs[count].file = frame->file;
+            reqs[count].write = 1;
+            reqs[count].offset = (off_t)frame->block_num * bf_block_size;
+            reqs[count].data = frame->data;
+            reqs[count].iov = run > 1 ? &iov[i] : NULL;
+            reqs[count].blocks = run;
+            reqs[count].result = 0;
+            first[count] = i;
+            count++;
+            i += run;
+        }
+        if (io_run(reqs, count) != BF_OK) {
+            code = BF_ERROR;
+        }
+
+        for (int r = 0; r < count; r++) {
+            if (reqs[r].result != reqs[r].blocks * bf_block_size) {
+                continue;
+            }
+            IO_STAT(reqs[r].file, io_calls_saved, reqs[r].blocks - 1);
+            for (int j = first[r]; j < first[r] + reqs[r].blocks; j++) {
+                BF_Frame *frame = &frames[sorted[j]];
+                /* The private mapping does not see writes to the file, copy the block there too */
+                BF_File *file = &files[frame->file];
+                if (file->map != NULL && frame->block_num < file->map_blocks) {
+                    memcpy(file->map + (off_t)frame->block_num * bf_block_size,
+                           frame->data, bf_block_size);
+                }
+                frame->dirty = 0;
+                IO_STAT(frame->file, writes, 1);
+            }
+        }
+    }
+    free(sorted);
+    free(iov);
+    return code;
+}
+
+
+/* 2Q ghost queue (A1out) */
+
+static int ghost_hash(BF_Shard *s, int file, int block_num) {
+    return block_hash(file, block_num) & (2 * s->ghost_size - 1);
+}
+
+static int ghost_find(BF_Shard *s, int file, int block_num, int **link_out) {
+    int *link = &s->ghost_table[ghost_hash(s, file, block_num)];
+    while (*link != -1) {
+        int g = *link;
+        if (s->ghost_file[g] == file && s->ghost_block[g] == block_num) {
+            if (link_out != NULL) {
+                *link_out = link;
+            }
+            return g;
+        }
+        link = &s->ghost_next[g];
+    }
+    return -1;
+}
+
+static void ghost_remove(BF_Shard *s, int file, int block_num) {
+    int *link;
+    int g = ghost_find(s, file, block_num, &link);
+    if (g != -1) {
+        *link = s->ghost_next[g];
+        s->ghost_file[g] = -1;
+    }
+}
+
+/* Remember a block evicted from A1in, forgetting the oldest one */
+static void ghost_add(BF_Shard *s, int file, int block_num) {
+    int g = s->ghost_pos;
+    s->ghost_pos = (s->ghost_pos + 1) % s->ghost_size;
+    if (s->ghost_file[g] != -1) {
+        ghost_remove(s, s->ghost_file[g], s->ghost_block[g]);
+    }
+    int h = ghost_hash(s, file, block_num);
+    s->ghost_file[g] = file;
+    s->ghost_block[g] = block_num;
+    s->ghost_next[g] = s->ghost_table[h];
+    s->ghost_table[h] = g;
+}
+
+
+/* Replacement policies, all called with the latch of the partition held */
+
+static void policy_reference(BF_Shard *s, int f) {
+    BF_Frame *frame = &frames[f];
+    s->clock_tick++;
+    frame->ref = 1;
+    for (int k = BF_LRU_K - 1; k > 0; k--) {
+        frame->hist[k] = frame->hist[k - 1];
+    }
+    frame->hist[0] = s->clock_tick;
+}
+
+/* A block was found in the pool */
+static void policy_hit(BF_Shard *s, int f) {
+    if (frames[f].prefetched) {
+        /* The first real reference of the block, not a second one */
+        int queue = frames[f].queue;
+        frames[f].prefetched = 0;
+        frames[f].ref = 1;
+        frames[f].hist[0] = ++s->clock_tick;
+        list_remove(s, f);
+        list_push_front(s, queue, f);
+        return;
+    }
+
+    policy_reference(s, f);
+    switch (bf_repl_alg) {
+        case LRU:
+        case MRU:
+            list_remove(s, f);
+            list_push_front(s, MAIN_LIST, f);
+            break;
+        case TWO_Q:
+            /* A second reference moves a block from A1in to Am */
+            list_remove(s, f);
+            list_push_front(s, MAIN_LIST, f);
+            break;
+        default:
+            break;
+    }
+}
+
+/* A block was brought into frame f */
+static void policy_load(BF_Shard *s, int f) {
+    for (int k = 0; k < BF_LRU_K; k++) {
+        frames[f].hist[k] = 0;
+    }
+    policy_reference(s, f);
+
+    if (bf_repl_alg == TWO_Q) {
+        int file = frames[f].file;
+        int block_num = frames[f].block_num;
+        /* Blocks seen again shortly after leaving A1in are hot */
+        if (ghost_find(s, file, block_num, NULL) != -1) {
+            ghost_remove(s, file, block_num);
+            list_push_front(s, MAIN_LIST, f);
+        } else {
+            list_push_front(s, A1IN_LIST, f);
+        }
+    } else {
+        list_push_front(s, MAIN_LIST, f);
+    }
+}
+
+static int clock_victim(BF_Shard *s) {
+    for (int step = 0; step < 2 * s->size; step++) {
+        int f = s->first + s->clock_hand;
+        s->clock_hand = (s->clock_hand + 1) % s->size;
+        if (pinned(f)) {
+            continue;
+        }
+        if (frames[f].ref) {
+            frames[f].ref = 0;
+            continue;
+        }
+        return f;
+    }
+    return -1;
+}
+
+static int two_q_victim(BF_Shard *s) {
+    int f = -1;
+    /* A1in keeps about a quarter of the partition, older blocks go to A1out */
+    if (s->lists[A1IN_LIST].size > s->size / 4 || s->lists[MAIN_LIST].size == 0) {
+        f = list_unpinned(s, A1IN_LIST, 1);
+        if (f != -1) {
+            ghost_add(s, frames[f].file, frames[f].block_num);
+            return f;
+        }
+    }
+    f = list_unpinned(s, MAIN_LIST, 1);
+    if (f == -1) {
+        f = list_unpinned(s, A1IN_LIST, 1);
+    }
+    return f;
+}
+
+/* The block with the oldest K-th reference goes first, blocks with
+   fewer than K references count as infinitely old */
+static int lru_k_victim(BF_Shard *s) {
+    int victim = -1;
+    for (int f = s->first; f < s->first + s->size; f++) {
+        if (frames[f].file == -1 || pinned(f)) {
+            continue;
+        }
+        if (victim == -1
+            || frames[f].hist[BF_LRU_K - 1] < frames[victim].hist[BF_LRU_K - 1]
+            || (frames[f].hist[BF_LRU_K - 1] == frames[victim].hist[BF_LRU_K - 1]
+                && frames[f].hist[0] < frames[victim].hist[0])) {
+            victim = f;
+        }
+    }
+    return victim;
+}
+
+static int policy_victim(BF_Shard *s) {
+    switch (bf_repl_alg) {
+        case LRU:
+            return list_unpinned(s, MAIN_LIST, 1);
+        case MRU:
+            return list_unpinned(s, MAIN_LIST, 0);
+        case CLOCK:
+            return clock_victim(s);
+        case TWO_Q:
+            return two_q_victim(s);
+        case LRU_K:
+            return lru_k_victim(s);
+    }
+    return -1;
+}
+
+
+/* Frame management, called with the latch of the partition held */
+
+static void release_frame(BF_Shard *s, int f) {
+    page_remove(s, f);
+    if (frames[f].queue != -1) {
+        list_remove(s, f);
+    }
+    frames[f].file = -1;
+    frames[f].block_num = -1;
+    frames[f].dirty = 0;
+    frames[f].loading = 0;
+    frames[f].pin_count = 0;
+    frames[f].ref = 0;
+    frames[f].next = s->free_frames;
+    s->free_frames = f;
+}
+
+/* Find a frame of the partition for a new block, evicting an unpinned one if needed */
+static BF_ErrorCode get_free_frame(BF_Shard *s, int *frame) {
+    if (s->free_frames != -1) {
+        *frame = s->free_frames;
+        s->free_frames = frames[*frame].next;
+        frames[*frame].next = -1;
+        return BF_OK;
+    }
+
+    int f = policy_victim(s);
+    if (f == -1) {
+        return BF_FULL_MEMORY_ERROR;
+    }
+
+    if (frames[f].dirty) {
+        /* Clean other unpinned dirty frames in the same submission, they
+           will not cost a write when their turn to leave comes */
+        int list[BF_IO_BATCH];
+        int n = 0;
+        list[n++] = f;
+        for (int g = s->first; g < s->first + s->size && n < BF_IO_BATCH; g++) {
+            if (g != f && !pinned(g) && frames[g].dirty) {
+                list[n++] = g;
+            }
+        }
+        if (write_frames(list, n) != BF_OK) {
+            return BF_ERROR;
+        }
+    }
+    SHARD_STAT(s, frames[f].file, evictions);
+    release_frame(s, f);
+    s->free_frames = frames[f].next;
+    frames[f].next = -1;
+    *frame = f;
+    return BF_OK;
+}
+
+static void load_frame(BF_Shard *s, int f, int file, int block_num) {
+    frames[f].file = file;
+    frames[f].block_num = block_num;
+    frames[f].pin_count = 1;
+    frames[f].loading = 0;
+    frames[f].dirty = 0;
+    frames[f].prefetched = 0;
+    page_insert(s, f);
+    policy_load(s, f);
+}
+
+static void fill_block(BF_Block *block, int file_desc, int block_num, int f) {
+    block->file_desc = file_desc;
+    block->block_num = block_num;
+    block->frame = f;
+    block->mapped_file = -1;
+    block->data = frames[f].data;
+}
+
+/* Move a block read from the mapping into the pool so that it can be written back */
+static void copy_mapped_block(BF_Block *block) {
+    BF_File *file = &files[block->mapped_file];
+    BF_Shard *s = shard_of(block->mapped_file, block->block_num);
+    pthread_mutex_lock(&s->latch);
+
+    /* Another handle of the block may have moved it already. The edits made
+       through this handle are only in the mapping, which the frame overwrites
+       when it is written back, so they are carried over to the frame */
+    int f = page_lookup(s, block->mapped_file, block->block_num);
+    if (f != -1) {
+        pin(f);
+        memcpy(frames[f].data, block->data, bf_block_size);
+    } else if (get_free_frame(s, &f) == BF_OK) {
+        memcpy(frames[f].data, block->data, bf_block_size);
+        load_frame(s, f, block->mapped_file, block->block_num);
+    } else {
+        /* No frame to keep it in, write it through */
+        BF_IORequest req = { file->fd, block->mapped_file, 1,
+                             (off_t)block->block_num * bf_block_size, block->data, NULL, 1, 0 };
+        if (io_run(&req, 1) != BF_OK) {
+            fprintf(stderr, "BF: write of block %d failed\n", block->block_num);
+        }
+        pthread_mutex_unlock(&s->latch);
+        return;
+    }
+    frames[f].dirty = 1;
+    pthread_mutex_unlock(&s->latch);
+
+    unpin(&file->map_pins);
+    fill_block(block, block->file_desc, block->block_num, f);
+}
+
+static void unmap_file(BF_File *file) {
+    if (file->map != NULL) {
+        munmap(file->map, (size_t)file->map_blocks * bf_block_size);
+        file->map = NULL;
+    }
+    file->map_blocks = 0;
+    file->map_pins = 0;
+}
+
+/* Write back the dirty blocks of a file (or of all files if file is -1) in
+   one batch. The caller holds every latch */
+static BF_ErrorCode flush_dirty(int file) {
+    int *list = malloc(bf_buffer_size * sizeof(int));
+    if (list == NULL) {
+        return BF_ERROR;
+    }
+    int n = 0;
+    for (int f = 0; f < bf_buffer_size; f++) {
+        if (frames[f].file != -1 && frames[f].dirty && (file == -1 || frames[f].file == file)) {
+            list[n++] = f;
+        }
+    }
+    BF_ErrorCode code = write_frames(list, n);
+    free(list);
+    return code;
+}
+
+/* Write back the dirty blocks of a file and drop them from the pool.
+   The caller holds every latch */
+static BF_ErrorCode flush_file(int file) {
+    BF_ErrorCode code = flush_dirty(file);
+    for (int f = 0; f < bf_buffer_size; f++) {
+        if (frames[f].file == file) {
+            release_frame(&shards[frames[f].shard], f);
+        }
+    }
+    /* The slot of the file may be reused by another one */
+    for (int i = 0; i < shard_count; i++) {
+        BF_Shard *s = &shards[i];
+        for (int g = 0; g < s->ghost_size; g++) {
+            if (s->ghost_file[g] == file) {
+                ghost_remove(s, file, s->ghost_block[g]);
+            }
+        }
+    }
+    return code;
+}
+
+/* Transparent huge pages are off when the kernel says so, whatever madvise returns */
+static int thp_disabled() {
+    char mode[128] = "";
+    FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (f == NULL) {
+        return 1;
+    }
+    if (fgets(mode, sizeof(mode), f) == NULL) {
+        mode[0] = '\0';
+    }
+    fclose(f);
+    return strstr(mode, "[never]") != NULL;
+}
+
+/* Allocate a region of at least bytes. A region of 2 MB or more comes from the
+   hugetlb reserve when there is one and otherwise from an aligned anonymous
+   mapping marked for transparent huge pages, so that random hits across many
+   frames miss the TLB less. Smaller regions keep normal pages */
+static void *region_alloc(BF_Region *r, size_t bytes) {
+    r->addr = NULL;
+    r->bytes = 0;
+    r->pages = BF_PAGES_NORMAL;
+    if (bytes >= BF_HUGE_PAGE_SIZE && bf_pool_pages != BF_PAGES_NORMAL) {
+        size_t huge = (bytes + BF_HUGE_PAGE_SIZE - 1) & ~(size_t)(BF_HUGE_PAGE_SIZE - 1);
+        if (bf_pool_pages == BF_PAGES_HUGETLB) {
+            void *addr = mmap(NULL, huge, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (addr != MAP_FAILED) {
+                r->addr = addr;
+                r->bytes = huge;
+                r->pages = BF_PAGES_HUGETLB;
+                return addr;
+            }
+        }
+        /* A huge page only backs an aligned 2 MB of the mapping, so map one
+           more and drop the unaligned head and tail */
+        char *addr = mmap(NULL, huge + BF_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr != MAP_FAILED) {
+            char *aligned = (char *)(((uintptr_t)addr + BF_HUGE_PAGE_SIZE - 1)
+                                     & ~(uintptr_t)(BF_HUGE_PAGE_SIZE - 1));
+            if (aligned > addr) {
+                munmap(addr, aligned - addr);
+            }
+            munmap(aligned + huge, addr + BF_HUGE_PAGE_SIZE - aligned);
+            r->addr = aligned;
+            r->bytes = huge;
+            if (madvise(aligned, huge, MADV_HUGEPAGE) == 0 && !thp_disabled()) {
+                r->pages = BF_PAGES_TRANSPARENT;
+            }
+            return aligned;
+        }
+    }
+    if (posix_memalign(&r->addr, BF_POOL_ALIGN, bytes) != 0) {
+        r->addr = NULL;
+    }
+    return r->addr;
+}
+
+static void region_free(BF_Region *r) {
+    if (r->bytes != 0) {
+        munmap(r->addr, r->bytes);
+    } else {
+        free(r->addr);
+    }
+    r->addr = NULL;
+    r->bytes = 0;
+}
+
+static void free_pool() {
+    for (int i = 0; i < shard_count; i++) {
+        BF_Shard *s = &shards[i];
+        free(s->page_table);
+        free(s->ghost_file);
+        free(s->ghost_block);
+        free(s->ghost_next);
+        free(s->ghost_table);
+        free(s->file_stats);
+        s->file_stats = NULL;
+        s->page_table = NULL;
+        s->ghost_file = s->ghost_block = s->ghost_next = s->ghost_table = NULL;
+        pthread_mutex_destroy(&s->latch);
+    }
+    shard_count = 0;
+    region_free(&pool_region);
+    region_free(&frames_region);
+    pool = NULL;
+    frames = NULL;
+}
+
+/* Set up partition i with frames [first, first + size) */
+static BF_ErrorCode init_shard(int i, int first, int size) {
+    BF_Shard *s = &shards[i];
+    s->first = first;
+    s->size = size;
+    s->page_table_size = 1;
+    while (s->page_table_size < 2 * size) {
+        s->page_table_size <<= 1;
+    }
+    s->ghost_size = 1;
+    while (s->ghost_size < size / 2) {
+        s->ghost_size <<= 1;
+    }
+
+    pthread_mutex_init(&s->latch, NULL);
+    shard_count = i + 1;
+    s->page_table = malloc(s->page_table_size * sizeof(int));
+    s->ghost_file = malloc(s->ghost_size * sizeof(int));
+    s->ghost_block = malloc(s->ghost_size * sizeof(int));
+    s->ghost_next = malloc(s->ghost_size * sizeof(int));
+    s->ghost_table = malloc(2 * s->ghost_size * sizeof(int));
+    s->file_stats = calloc(BF_MAX_OPEN_FILES, sizeof(BF_Stats));
+    if (s->page_table == NULL || s->ghost_file == NULL || s->ghost_block == NULL
+        || s->ghost_next == NULL || s->ghost_table == NULL || s->file_stats == NULL) {
+        return BF_ERROR;
+    }
+
+    for (int h = 0; h < s->page_table_size; h++) {
+        s->page_table[h] = -1;
+    }
+    for (int f = first; f < first + size; f++) {
+        frames[f].shard = i;
+        frames[f].next = (f + 1 < first + size) ? f + 1 : -1;
+    }
+    s->free_frames = first;
+    for (int q = 0; q < 2; q++) {
+        s->lists[q].head = s->lists[q].tail = -1;
+        s->lists[q].size = 0;
+    }
+    s->clock_hand = 0;
+    s->clock_tick = 0;
+
+    for (int g = 0; g < s->ghost_size; g++) {
+        s->ghost_file[g] = -1;
+    }
+    for (int h = 0; h < 2 * s->ghost_size; h++) {
+        s->ghost_table[h] = -1;
+    }
+    s->ghost_pos = 0;
+    memset(&s->stats, 0, sizeof(s->stats));
+    return BF_OK;
+}
+
+static int valid_file_desc(int file_desc) {
+    return bf_active && file_desc >= 0 && file_desc < BF_MAX_OPEN_FILES
+        && open_files[file_desc] != -1;
+}
+
+static int block_count(int file) {
+    return __atomic_load_n(&files[file].block_count, __ATOMIC_ACQUIRE);
+}
+
+
+_Static_assert(sizeof(BF_Block) <= sizeof(BF_BlockStorage), "BF_BlockStorage is too small for BF_Block");
+
+static void block_reset(BF_Block *block) {
+    block->file_desc = -1;
+    block->block_num = -1;
+    block->frame = -1;
+    block->mapped_file = -1;
+    block->data = NULL;
+}
+
+void BF_Block_Init(BF_Block **block) {
+    *block = malloc(sizeof(BF_Block));
+    block_reset(*block);
+}
+
+BF_Block *BF_Block_InitIn(BF_BlockStorage *storage) {
+    BF_Block *block = (BF_Block *)storage;
+    block_reset(block);
+    return block;
+}
+
+void BF_Block_Destroy(BF_Block **block) {
+    free(*block);
+    *block = NULL;
+}
+
+void BF_Block_SetDirty(BF_Block *block) {
+    if (block->mapped_file != -1) {
+        copy_mapped_block(block);
+    }
+    if (block->frame != -1) {
+        /* The frame is pinned, nobody writes it back before the pin is dropped */
+        frames[block->frame].dirty = 1;
+    }
+}
+
+char* BF_Block_GetData(const BF_Block *block) {
+    return block->data;
+}
+
+int BF_GetBlockSize() {
+    return bf_block_size;
+}
+
+BF_IOBackend BF_GetIOBackend() {
+#ifdef BF_HAVE_IO_URING
+    if (ring.fd != -1) {
+        return BF_IO_URING;
+    }
+#endif
+    return BF_IO_PSYNC;
+}
+
+BF_ErrorCode BF_SetPoolPages(const BF_PoolPages pages) {
+    if (bf_active) {
+        return BF_ACTIVE_ERROR;
+    }
+    bf_pool_pages = pages;
+    return BF_OK;
+}
+
+BF_PoolPages BF_GetPoolPages() {
+    return pool_region.pages;
+}
+
+BF_ErrorCode BF_Init(const ReplacementAlgorithm repl_alg,
+                     const int block_size,
+                     const int buffer_size) {
+    if (bf_active) {
+        return BF_ACTIVE_ERROR;
+    }
+
+    int bsize = block_size == 0 ? BF_DEFAULT_BLOCK_SIZE : block_size;
+    int nframes = buffer_size == 0 ? BF_DEFAULT_BUFFER_SIZE : buffer_size;
+    if (!is_power_of_two(bsize) || bsize < BF_MIN_BLOCK_SIZE
+        || bsize > BF_MAX_BLOCK_SIZE || nframes < 1) {
+        return BF_INVALID_CONFIG_ERROR;
+    }
+
+    /* The pool starts on a BF_POOL_ALIGN (4096) boundary and the block size is a
+       power of two, so every frame is aligned to the smaller of the two; that is
+       what O_DIRECT needs and what direct_aligned() checks */
+    pool = region_alloc(&pool_region, (size_t)nframes * bsize);
+    frames = region_alloc(&frames_region, (size_t)nframes * sizeof(BF_Frame));
+    if (pool == NULL || frames == NULL) {
+        free_pool();
+        return BF_ERROR;
+    }
+
+    bf_repl_alg = repl_alg;
+    bf_block_size = bsize;
+    bf_buffer_size = nframes;
+
+    for (int f = 0; f < nframes; f++) {
+        frames[f].file = -1;
+        frames[f].block_num = -1;
+        frames[f].pin_count = 0;
+        frames[f].loading = 0;
+        frames[f].dirty = 0;
+        frames[f].hash_next = -1;
+        frames[f].queue = -1;
+        frames[f].prev = -1;
+        frames[f].ref = 0;
+        frames[f].prefetched = 0;
+        frames[f].data = pool + (size_t)f * bsize;
+    }
+
+    /* A power of two number of partitions, none smaller than BF_SHARD_FRAMES */
+    int nshards = 1;
+    while (nshards * 2 <= BF_MAX_SHARDS && nshards * 2 * BF_SHARD_FRAMES <= nframes) {
+        nshards *= 2;
+    }
+    for (int i = 0; i < nshards; i++) {
+        int first = (int)((long)nframes * i / nshards);
+        int last = (int)((long)nframes * (i + 1) / nshards);
+        if (init_shard(i, first, last - first) != BF_OK) {
+            free_pool();
+            return BF_ERROR;
+        }
+    }
+
+    memset(&io_stats, 0, sizeof(io_stats));
+#ifdef BF_HAVE_IO_URING
+    uring_open();
+#endif
+
+    for (int i = 0; i < BF_MAX_OPEN_FILES; i++) {
+        files[i].used = 0;
+        open_files[i] = -1;
+    }
+
+    bf_active = 1;
+    return BF_OK;
+}
+
+BF_ErrorCode BF_CreateFile(const char* filename) {
+    int fd = open(filename, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        return BF_FILE_ALREADY_EXISTS;
+    }
+    close(fd);
+    return BF_OK;
+}
+
+BF_ErrorCode BF_OpenFile(const char* filename, int *file_desc) {
+    return BF_OpenFileMode(filename, file_desc, BF_OPEN_BUFFERED);
+}
+
+/* Whether the blocks and frames meet the alignment O_DIRECT asks for on the file */
+static int direct_aligned(int fd) {
+    unsigned int align = 512;    /* logical sector size of most devices */
+#ifdef STATX_DIOALIGN
+    struct statx stx;
+    if (statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 && (stx.stx_mask & STATX_DIOALIGN)) {
+        if (stx.stx_dio_offset_align == 0) {
+            return 0;    /* no direct I/O on this file */
+        }
+        align = stx.stx_dio_offset_align > stx.stx_dio_mem_align
+            ? stx.stx_dio_offset_align : stx.stx_dio_mem_align;
+    }
+#endif
+    return bf_block_size % align == 0 && BF_POOL_ALIGN % align == 0;
+}
+
+static BF_ErrorCode open_file(const char* filename, int *file_desc, const BF_OpenMode mode) {
+    int slot = -1;
+    for (int i = 0; i < BF_MAX_OPEN_FILES; i++) {
+        if (open_files[i] == -1) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == -1) {
+        return BF_OPEN_FILES_LIMIT_ERROR;
+    }
+
+    struct stat st;
+    if (stat(filename, &st) != 0) {
+        return BF_ERROR;
+    }
+
+    /* If the file is already open the new file_desc shares its blocks */
+    int file = -1;
+    for (int i = 0; i < BF_MAX_OPEN_FILES; i++) {
+        if (files[i].used && files[i].dev == st.st_dev && files[i].ino == st.st_ino) {
+            file = i;
+            break;
+        }
+    }
+
+    if (file == -1) {
+        for (int i = 0; i < BF_MAX_OPEN_FILES; i++) {
+            if (!files[i].used) {
+                file = i;
+                break;
+            }
+        }
+        int fd = open(filename, mode == BF_OPEN_DIRECT ? O_RDWR | O_DIRECT : O_RDWR);
+        if (fd < 0) {
+            return BF_ERROR;
+        }
+        if (mode == BF_OPEN_DIRECT && !direct_aligned(fd)) {
+            close(fd);
+            return BF_INVALID_CONFIG_ERROR;
+        }
+        files[file].used = 1;
+        files[file].direct = mode == BF_OPEN_DIRECT;
+        files[file].fd = fd;
+        files[file].dev = st.st_dev;
+        files[file].ino = st.st_ino;
+        files[file].block_count = (int)(st.st_size / bf_block_size);
+        files[file].open_count = 0;
+        files[file].map = NULL;
+        files[file].map_blocks = 0;
+        files[file].map_pins = 0;
+        /* The counters of the slot start over for the new file */
+        memset(&files[file].stats, 0, sizeof(BF_Stats));
+        for (int i = 0; i < shard_count; i++) {
+            pthread_mutex_lock(&shards[i].latch);
+            memset(&shards[i].file_stats[file], 0, sizeof(BF_Stats));
+            pthread_mutex_unlock(&shards[i].latch);
+        }
+
+        if (mode == BF_OPEN_MMAP && files[file].block_count > 0) {
+            /* Private so that a caller writing in a block never changes the file behind
+               the pool, the block is copied into a frame when it becomes dirty */
+            size_t length = (size_t)files[file].block_count * bf_block_size;
+            void *map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                files[file].map = map;
+                files[file].map_blocks = files[file].block_count;
+            }
+        }
+    }
+
+    files[file].open_count++;
+    open_files[slot] = file;
+    *file_desc = slot;
+    return BF_OK;
+}
+
+BF_ErrorCode BF_OpenFileMode(const char* filename, int *file_desc, const BF_OpenMode mode) {
+    if (!bf_active) {
+        return BF_ERROR;
+    }
+    pthread_mutex_lock(&files_latch);
+    BF_ErrorCode code = open_file(filename, file_desc, mode);
+    pthread_mutex_unlock(&files_latch);
+    return code;
+}
+
+static BF_ErrorCode close_file(const int file_desc) {
+    int file = open_files[file_desc];
+
+    /* The last file_desc of a file takes the cached blocks with it */
+    if (files[file].open_count == 1) {
+        if (__atomic_load_n(&files[file].map_pins, __ATOMIC_ACQUIRE) > 0) {
+            return BF_AVAILABLE_PIN_BLOCKS_ERROR;
+        }
+        lock_all();
+        for (int f = 0; f < bf_buffer_size; f++) {
+            if (frames[f].file == file && pinned(f)) {
+                unlock_all();
+                return BF_AVAILABLE_PIN_BLOCKS_ERROR;
+            }
+        }
+        BF_ErrorCode code = flush_file(file);
+        unlock_all();
+        unmap_file(&files[file]);
+        close(files[file].fd);
+        files[file].used = 0;
+        if (code != BF_OK) {
+            open_files[file_desc] = -1;
+            return code;
+        }
+    }
+
+    files[file].open_count--;
+    open_files[file_desc] = -1;
+    return BF_OK;
+}
+
+BF_ErrorCode BF_CloseFile(const int file_desc) {
+    pthread_mutex_lock(&files_latch);
+    if (!valid_file_desc(file_desc)) {
+        pthread_mutex_unlock(&files_latch);
+        return BF_INVALID_FILE_ERROR;
+    }
+    BF_ErrorCode code = close_file(file_desc);
+    pthread_mutex_unlock(&files_latch);
+    return code;
+}
+
+BF_ErrorCode BF_GetBlockCounter(const int file_desc, int *blocks_num) {
+    if (!valid_file_desc(file_desc)) {
+        return BF_INVALID_FILE_ERROR;
+    }
+    *blocks_num = block_count(open_files[file_desc]);
+    return BF_OK;
+}
+
+BF_ErrorCode BF_AllocateBlock(const int file_desc, BF_Block *block) {
+    if (!valid_file_desc(file_desc)) {
+        return BF_INVALID_FILE_ERROR;
+    }
+    int file = open_files[file_desc];
+
+    /* Here the counter moves under the latch of the partition of the new
+       block, so a reader that sees the block also finds its frame.
+       BF_AllocateBlocks moves it without latches, see there */
+    BF_Shard *s;
+    int block_num;
+    for (;;) {
+        block_num = block_count(file);
+        s = shard_of(file, block_num);
+        pthread_mutex_lock(&s->latch);
+        if (__atomic_compare_exchange_n(&files[file].block_count, &block_num, block_num + 1,
+                                        0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            break;
+        }
+        pthread_mutex_unlock(&s->latch);
+    }
+
+    int f;
+    BF_ErrorCode code = get_free_frame(s, &f);
+    if (code != BF_OK) {
+        /* Give the number back if no other block was allocated meanwhile */
+        int next = block_num + 1;
+        __atomic_compare_exchange_n(&files[file].block_count, &next, block_num,
+                                    0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&s->latch);
+        return code;
+    }
+
+    memset(frames[f].data, 0, bf_block_size);
+    load_frame(s, f, file, block_num);
+    /* A new block has to reach the disk even if nobody writes in it */
+    frames[f].dirty = 1;
+    pthread_mutex_unlock(&s->latch);
+
+    fill_block(block, file_desc, block_num, f);
+    return BF_OK;
+}
+
+BF_ErrorCode BF_AllocateBlocks(const int file_desc, const int n, int *first_block,
+                               BF_Block **blocks) {
+    if (!valid_file_desc(file_desc)) {
+        return BF_INVALID_FILE_ERROR;
+    }
+    if (n < 1) {
+        return BF_ERROR;
+    }
+    int file = open_files[file_desc];
+
+    /* The numbers are taken first, without a latch: one extent spans many
+       partitions. A reader that gets one of the blocks before the loop below
+       finds no frame and reads it like any other miss. A read before the
+       extent reaches the disk comes back short and io_run fills it with
+       zeros, which is what the block holds. The loop then finds that frame
+       with page_lookup_loaded and uses it, so the block never gets two */
+    int first = __atomic_fetch_add(&files[file].block_count, n, __ATOMIC_ACQ_REL);
+    off_t offset = (off_t)first * bf_block_size;
+    off_t length = (off_t)n * bf_block_size;
+    if (fallocate(files[file].fd, 0, offset, length) != 0
+        && posix_fallocate(files[file].fd, offset, length) != 0) {
+        /* Give the numbers back if no other block was allocated meanwhile */
+        int next = first + n;
+        __atomic_compare_exchange_n(&files[file].block_count, &next, first,
+                                    0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        return BF_ERROR;
+    }
+    if (first_block != NULL) {
+        *first_block = first;
+    }
+
+    /* The extent is already zeros on disk, so the frames of its blocks start clean */
+    for (int i = 0; i < n; i++) {
+        int block_num = first + i;
+        BF_Shard *s = shard_of(file, block_num);
+        pthread_mutex_lock(&s->latch);
+        int f = page_lookup_loaded(s, file, block_num);
+        if (blocks != NULL) {
+            BF_ErrorCode code = BF_OK;
+            if (f != -1) {
+                pin(f);
+            } else if ((code = get_free_frame(s, &f)) == BF_OK) {
+                memset(frames[f].data, 0, bf_block_size);
+                load_frame(s, f, file, block_num);
+            }
+            pthread_mutex_unlock(&s->latch);
+            if (code != BF_OK) {
+                for (int j = 0; j < i; j++) {
+                    BF_UnpinBlock(blocks[j]);
+                }
+                return code;
+            }
+            fill_block(blocks[i], file_desc, block_num, f);
+            continue;
+        }
+
+        /* Unpinned blocks only take frames that are free, so that their
+           first BF_GetBlock does not read them, and evict nothing */
+        if (f == -1 && s->free_frames != -1 && get_free_frame(s, &f) == BF_OK) {
+            memset(frames[f].data, 0, bf_block_size);
+            load_frame(s, f, file, block_num);
+            frames[f].pin_count = 0;
+            frames[f].prefetched = 1;
+        }
+        pthread_mutex_unlock(&s->latch);
+    }
+    return BF_OK;
+}
+
+BF_ErrorCode BF_GetBlock(const int file_desc,
+                         const int block_num,
+                         BF_Block *block) {
+    if (!valid_file_desc(file_desc)) {
+        return BF_INVALID_FILE_ERROR;
+    }
+    int file = open_files[file_desc];
+    if (block_num < 0 || block_num >= block_count(file)) {
+        return BF_INVALID_BLOCK_NUMBER_ERROR;
+    }
+
+    BF_Shard *s = shard_of(file, block_num);
+    pthread_mutex_lock(&s->latch);
+    SHARD_STAT(s, file, gets);
+    int f = page_lookup_loaded(s, file, block_num);
+    if (f != -1) {
+        SHARD_STAT(s, file, hits);
+        pin(f);
+        policy_hit(s, f);
+        pthread_mutex_unlock(&s->latch);
+        fill_block(block, file_desc, block_num, f);
+        return BF_OK;
+    }
+
+    /* Blocks of a mapped file are handed out in place, the pin is only counted */
+    BF_File *mapped = &files[file];
+    if (mapped->map != NULL && block_num < mapped->map_blocks) {
+        SHARD_STAT(s, file, hits);
+        __atomic_fetch_add(&mapped->map_pins, 1, __ATOMIC_ACQUIRE);
+        pthread_mutex_unlock(&s->latch);
+        block->file_desc = file_desc;
+        block->block_num = block_num;
+        block->frame = -1;
+        block->mapped_file = file;
+        block->data = mapped->map + (size_t)block_num * bf_block_size;
+        return BF_OK;
+    }
+
+    BF_ErrorCode code = get_free_frame(s, &f);
+    if (code != BF_OK) {
+        pthread_mutex_unlock(&s->latch);
+        return code;
+    }
+    /* The frame is pinned and in the page table while the block is read,
+       the latch is free for the other blocks of the partition */
+    load_frame(s, f, file, block_num);
+    frames[f].loading = 1;
+    pthread_mutex_unlock(&s->latch);
+
+    code = read_block(file, block_num, frames[f].data);
+
+    pthread_mutex_lock(&s->latch);
+    if (code != BF_OK) {
+        release_frame(s, f);
+        pthread_mutex_unlock(&s->latch);
+        return BF_ERROR;
+    }
+    frames[f].loading = 0;
+    SHARD_STAT(s, file, reads);
+    pthread_mutex_unlock(&s->latch);
+
+    fill_block(block, file_desc, block_num, f);
+    return BF_OK;
+}
+
+/* Whether the block is in the pool, for the read-ahead hints */
+static int cached(int file, int block_num) {
+    BF_Shard *s = shard_of(file, block_num);
+    pthread_mutex_lock(&s->latch);
+    int f = page_lookup(s, file, block_num);
+    pthread_mutex_unlock(&s->latch);
+    return f != -1;
+}
+
+BF_ErrorCode BF_Prefetch(const int file_desc,
+                         const int *block_ids,
+                         const int n) {
+    if (!valid_file_desc(file_desc)) {
+        return BF_INVALID_FILE_ERROR;
+    }
+    int file = open_files[file_desc];
+    BF_File *bf_file = &files[file];
+
+    /* Only a hint to the kernel: reading the blocks into the pool here would
+       make the caller wait for them, and the read-ahead is meant to overlap
+       with its work on the blocks it already has */
+
+    /* The page cache is not used by O_DIRECT reads, a hint to fill it only costs memory */
+    if (bf_file->direct) {
+        return BF_OK;
+    }
+
+    int blocks = block_count(file);
+    int i = 0;
+    while (i < n) {
+        int first = block_ids[i++];
+        if (first < 0 || first >= blocks || cached(file, first)) {
+            continue;
+        }
+        /* Ask for runs of consecutive blocks with one call */
+        int count = 1;
+        while (i < n && block_ids[i] == first + count && block_ids[i] < blocks
+               && !cached(file, block_ids[i])) {
+            count++;
+            i++;
+        }
+
+        off_t offset = (off_t)first * bf_block_size;
+        size_t length = (size_t)count * bf_block_size;
+        if (bf_file->map != NULL && first < bf_file->map_blocks) {
+            /* madvise wants a page aligned start */
+            size_t skew = offset % sysconf(_SC_PAGESIZE);
+            madvise(bf_file->map + offset - skew, length + skew, MADV_WILLNEED);
+        } else {
+            posix_fadvise(bf_file->fd, offset, length, POSIX_FADV_WILLNEED);
+        }
+        IO_STAT(file, prefetches, count);
+    }
+    return BF_OK;
+}
+
+BF_ErrorCode BF_UnpinBlock(BF_Block *block) {
+    if (!bf_active) {
+        return BF_ERROR;
+    }
+    if (block->mapped_file != -1) {
+        unpin(&files[block->mapped_file].map_pins);
+        return BF_OK;
+    }
+    if (block->frame == -1) {
+        return BF_ERROR;
+    }
+    unpin(&frames[block->frame].pin_count);
+    return BF_OK;
+}
+
+void BF_PrintError(BF_ErrorCode err) {
+    switch (err) {
+        case BF_OK:
+            fprintf(stderr, "BF: no error\n");
+            break;
+        case BF_OPEN_FILES_LIMIT_ERROR:
+            fprintf(stderr, "BF: there are already %d open files\n", BF_MAX_OPEN_FILES);
+            break;
+        case BF_INVALID_FILE_ERROR:
+            fprintf(stderr, "BF: the file descriptor does not belong to an open file\n");
+            break;
+        case BF_ACTIVE_ERROR:
+            fprintf(stderr, "BF: the BF layer is already initialized\n");
+            break;
+        case BF_FILE_ALREADY_EXISTS:
+            fprintf(stderr, "BF: the file cannot be created because it already exists\n");
+            break;
+        case BF_FULL_MEMORY_ERROR:
+            fprintf(stderr, "BF: the buffer is full of pinned blocks\n");
+            break;
+        case BF_INVALID_BLOCK_NUMBER_ERROR:
+            fprintf(stderr, "BF: the requested block does not exist in the file\n");
+            break;
+        case BF_AVAILABLE_PIN_BLOCKS_ERROR:
+            fprintf(stderr, "BF: the file cannot close because it has pinned blocks\n");
+            break;
+        case BF_INVALID_CONFIG_ERROR:
+            fprintf(stderr, "BF: invalid block size or buffer size\n");
+            break;
+        default:
+            fprintf(stderr, "BF: error\n");
+            break;
+    }
+}
+
+/* Add up the counters of one file, or of all the files if file is -1 */
+static void collect_stats(int file, BF_Stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < shard_count; i++) {
+        BF_Shard *s = &shards[i];
+        pthread_mutex_lock(&s->latch);
+        BF_Stats *counters = file == -1 ? &s->stats : &s->file_stats[file];
+        stats->gets += counters->gets;
+        stats->hits += counters->hits;
+        stats->reads += counters->reads;
+        stats->evictions += counters->evictions;
+        for (int f = s->first; f < s->first + s->size; f++) {
+            if (frames[f].file != -1 && (file == -1 || frames[f].file == file)) {
+                stats->pins += __atomic_load_n(&frames[f].pin_count, __ATOMIC_RELAXED);
+            }
+        }
+        pthread_mutex_unlock(&s->latch);
+    }
+    for (int i = 0; i < BF_MAX_OPEN_FILES; i++) {
+        if (files[i].used && (file == -1 || i == file)) {
+            stats->pins += __atomic_load_n(&files[i].map_pins, __ATOMIC_RELAXED);
+        }
+    }
+
+    BF_Stats *io = file == -1 ? &io_stats : &files[file].stats;
+    stats->prefetches = __atomic_load_n(&io->prefetches, __ATOMIC_RELAXED);
+    stats->writes = __atomic_load_n(&io->writes, __ATOMIC_RELAXED);
+    stats->bytes_read = __atomic_load_n(&io->bytes_read, __ATOMIC_RELAXED);
+    stats->bytes_written = __atomic_load_n(&io->bytes_written, __ATOMIC_RELAXED);
+    stats->io_calls = __atomic_load_n(&io->io_calls, __ATOMIC_RELAXED);
+    stats->io_calls_saved = __atomic_load_n(&io->io_calls_saved, __ATOMIC_RELAXED);
+}
+
+BF_ErrorCode BF_GetStats(const int file_desc, BF_Stats *stats) {
+    if (!valid_file_desc(file_desc)) {
+        return BF_INVALID_FILE_ERROR;
+    }
+    collect_stats(open_files[file_desc], stats);
+    return BF_OK;
+}
+
+void BF_GetGlobalStats(BF_Stats *stats) {
+    collect_stats(-1, stats);
+}
+
+void BF_ResetStats() {
+    for (int i = 0; i < shard_count; i++) {
+        BF_Shard *s = &shards[i];
+        pthread_mutex_lock(&s->latch);
+        memset(&s->stats, 0, sizeof(s->stats));
+        memset(s->file_stats, 0, BF_MAX_OPEN_FILES * sizeof(BF_Stats));
+        pthread_mutex_unlock(&s->latch);
+    }
+    memset(&io_stats, 0, sizeof(io_stats));
+    for (int i = 0; i < BF_MAX_OPEN_FILES; i++) {
+        memset(&files[i].stats, 0, sizeof(BF_Stats));
+    }
+}
+
+BF_ErrorCode BF_Close() {
+    if (!bf_active) {
+        return BF_ERROR;
+    }
+
+    pthread_mutex_lock(&files_latch);
+    lock_all();
+    /* All the dirty blocks of all the files go out together */
+    BF_ErrorCode code = flush_dirty(-1);
+    for (int i = 0; i < BF_MAX_OPEN_FILES; i++) {
+        if (files[i].used) {
+            if (flush_file(i) != BF_OK) {
+                code = BF_ERROR;
+            }
+            unmap_file(&files[i]);
+            close(files[i].fd);
+            files[i].used = 0;
+        }
+        open_files[i] = -1;
+    }
+    unlock_all();
+
+    free_pool();
+#ifdef BF_HAVE_IO_URING
+    uring_close();
+#endif
+    bf_active = 0;
+    pthread_mutex_unlock(&files_latch);
+    return code;
+}
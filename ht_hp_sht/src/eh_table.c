@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "bf.h"
+#include "eh_table.h"
+#include "record.h"
+
+#define NEXT    (BF_GetBlockSize()-sizeof(EH_block_info))
+#define MAX_REC ((BF_GetBlockSize()-sizeof(EH_block_info))/sizeof(Record))
+#define DIR_ENTRIES (BF_GetBlockSize()/sizeof(int))   /* directory entries per block */
+
+
+/* The directory is indexed by the low globalDepth bits of the hash. The
+   upper half of the product by 2^64/phi depends on every bit of the key, so
+   ids that share their low bits, such as multiples of a power of two, do
+   not all land in one bucket and force doubling after doubling */
+static unsigned int eh_hash(int key){
+    return (uint64_t)(uint32_t)key * 0x9E3779B97F4A7C15ull >> 32;
+}
+
+/* The bucket block that directory entry i points to */
+static int dir_get(const EH_info *eh_info, unsigned int i, int *bucket){
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    if (BF_GetBlock(eh_info->fileDesc, eh_info->dirFirst + i / DIR_ENTRIES, block) != BF_OK){
+        return -1;
+    }
+    *bucket = ((int *)BF_Block_GetData(block))[i % DIR_ENTRIES];
+    return BF_UnpinBlock(block) == BF_OK ? 0 : -1;
+}
+
+static int dir_set(const EH_info *eh_info, unsigned int i, int bucket){
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    if (BF_GetBlock(eh_info->fileDesc, eh_info->dirFirst + i / DIR_ENTRIES, block) != BF_OK){
+        return -1;
+    }
+    ((int *)BF_Block_GetData(block))[i % DIR_ENTRIES] = bucket;
+    BF_Block_SetDirty(block);
+    return BF_UnpinBlock(block) == BF_OK ? 0 : -1;
+}
+
+/* Double the directory, entry i + 2^globalDepth points where entry i does.
+   A directory that outgrows its blocks moves to a new run at the end of the
+   file, twice as long, and the old run is left unused */
+static int dir_double(EH_info *eh_info){
+    unsigned int size = 1u << eh_info->globalDepth;
+    BF_BlockStorage storage[2];
+    BF_Block *from = BF_Block_InitIn(&storage[0]);
+    BF_Block *to = BF_Block_InitIn(&storage[1]);
+
+    if (2 * size <= DIR_ENTRIES){
+        /* Still one block, the upper half is a copy of the lower one */
+        if (BF_GetBlock(eh_info->fileDesc, eh_info->dirFirst, to) != BF_OK){
+            return -1;
+        }
+        int *entries = (int *)BF_Block_GetData(to);
+        memcpy(entries + size, entries, size * sizeof(int));
+        BF_Block_SetDirty(to);
+        if (BF_UnpinBlock(to) != BF_OK){
+            return -1;
+        }
+    } else {
+        int old_first = eh_info->dirFirst;
+        int old_blocks = eh_info->dirBlocks;
+        int new_blocks = 2 * size / DIR_ENTRIES;
+        int first;
+        if (BF_AllocateBlocks(eh_info->fileDesc, new_blocks, &first, NULL) != BF_OK){
+            return -1;
+        }
+        for (int b = 0; b < new_blocks; b++){
+            if (BF_GetBlock(eh_info->fileDesc, old_first + b % old_blocks, from) != BF_OK){
+                return -1;
+            }
+            if (BF_GetBlock(eh_info->fileDesc, first + b, to) != BF_OK){
+                BF_UnpinBlock(from);
+                return -1;
+            }
+            memcpy(BF_Block_GetData(to), BF_Block_GetData(from), BF_GetBlockSize());
+            BF_Block_SetDirty(to);
+            if (BF_UnpinBlock(to) != BF_OK || BF_UnpinBlock(from) != BF_OK){
+                return -1;
+            }
+        }
+        eh_info->dirFirst = first;
+        eh_info->dirBlocks = new_blocks;
+    }
+
+    eh_info->globalDepth++;
+    eh_info->doublings++;
+    return 0;
+}
+
+/* Split the full bucket of directory entry index. The records whose hash has
+   bit localDepth set move to a new bucket, and so do the directory entries */
+static int bucket_split(EH_info *eh_info, unsigned int index, BF_Block *old_block){
+    void *old_data = BF_Block_GetData(old_block);
+    EH_block_info *old_info = old_data + NEXT;
+    int depth = old_info->localDepth;
+
+    BF_Block *new_block = BF_Block_InitIn(&eh_info->handles[1]);
+    int new_bucket;
+    if (BF_AllocateBlocks(eh_info->fileDesc, 1, &new_bucket, &new_block) != BF_OK){
+        return -1;
+    }
+    void *new_data = BF_Block_GetData(new_block);
+    EH_block_info *new_info = new_data + NEXT;
+    new_info->recordsCounter = 0;
+    new_info->localDepth = depth + 1;
+
+    /* Move the records and close the gaps they leave */
+    Record *old_records = old_data;
+    Record *new_records = new_data;
+    int kept = 0;
+    for (int i = 0; i < old_info->recordsCounter; i++){
+        if (eh_hash(old_records[i].id) >> depth & 1){
+            new_records[new_info->recordsCounter++] = old_records[i];
+        } else {
+            old_records[kept++] = old_records[i];
+        }
+    }
+    old_info->recordsCounter = kept;
+    old_info->localDepth = depth + 1;
+    BF_Block_SetDirty(new_block);
+    if (BF_UnpinBlock(new_block) != BF_OK){
+        return -1;
+    }
+
+    /* The entries of the old bucket are the ones that agree with index in
+       the low depth bits, those with bit depth set now point to the new one */
+    unsigned int low = index & ((1u << depth) - 1);
+    for (unsigned int i = low | 1u << depth; i < 1u << eh_info->globalDepth; i += 1u << (depth + 1)){
+        if (dir_set(eh_info, i, new_bucket) == -1){
+            return -1;
+        }
+    }
+
+    eh_info->buckets++;
+    eh_info->splits++;
+    return 0;
+}
+
+
+int EH_CreateFile(char *fileName){
+    if (BF_CreateFile(fileName) != BF_OK){
+        return -1;
+    }
+    int fileDesc;
+    if (BF_OpenFile(fileName, &fileDesc) != BF_OK){
+        return -1;
+    }
+
+    /* Block 0 the header, block 1 the directory, block 2 the only bucket */
+    BF_BlockStorage storage[3];
+    BF_Block *blocks[3];
+    for (int i = 0; i < 3; i++){
+        blocks[i] = BF_Block_InitIn(&storage[i]);
+    }
+    if (BF_AllocateBlocks(fileDesc, 3, NULL, blocks) != BF_OK){
+        return -1;
+    }
+
+    EH_info *eh_info = (EH_info *)BF_Block_GetData(blocks[0]);
+    eh_info->fileDesc = fileDesc;
+    eh_info->globalDepth = 0;
+    eh_info->dirFirst = 1;
+    eh_info->dirBlocks = 1;
+    eh_info->buckets = 1;
+    eh_info->splits = 0;
+    eh_info->doublings = 0;
+
+    ((int *)BF_Block_GetData(blocks[1]))[0] = 2;
+
+    EH_block_info *block_info = (void *)BF_Block_GetData(blocks[2]) + NEXT;
+    block_info->recordsCounter = 0;
+    block_info->localDepth = 0;
+
+    for (int i = 0; i < 3; i++){
+        BF_Block_SetDirty(blocks[i]);
+        if (BF_UnpinBlock(blocks[i]) != BF_OK){
+            return -1;
+        }
+    }
+    return BF_CloseFile(fileDesc) == BF_OK ? 0 : -1;
+}
+
+
+EH_info* EH_OpenFile(char *fileName){
+    int fileDesc;
+    if (BF_OpenFile(fileName, &fileDesc) != BF_OK){
+        return NULL;
+    }
+
+    /* The header block stays pinned until EH_CloseFile */
+    BF_Block *block;
+    BF_Block_Init(&block);
+    if (BF_GetBlock(fileDesc, 0, block) != BF_OK){
+        BF_Block_Destroy(&block);
+        return NULL;
+    }
+
+    EH_info *info = malloc(sizeof(EH_info));
+    memcpy(info, BF_Block_GetData(block), sizeof(EH_info));
+
+    /* The descriptor and the handle stored in the header belong to the run that created the file */
+    info->fileDesc = fileDesc;
+    info->first_block = block;
+    return info;
+}
+
+
+int EH_CloseFile(EH_info* eh_info){
+    /* The depth and the place of the directory are kept for the next EH_OpenFile */
+    EH_info *header_info = (EH_info *)BF_Block_GetData(eh_info->first_block);
+    memcpy(header_info, eh_info, sizeof(EH_info));
+    BF_Block_SetDirty(eh_info->first_block);
+    if (BF_UnpinBlock(eh_info->first_block) != BF_OK){
+        return -1;
+    }
+    BF_Block_Destroy(&eh_info->first_block);
+
+    if (BF_CloseFile(eh_info->fileDesc) != BF_OK){
+        return -1;
+    }
+    free(eh_info);
+    return 0;
+}
+
+
+int EH_InsertEntry(EH_info* eh_info, Record record){
+    unsigned int hash = eh_hash(record.id);
+
+    /* The handle lives in eh_info, an insert does not allocate memory */
+    BF_Block *block = BF_Block_InitIn(&eh_info->handles[0]);
+
+    for (;;){
+        unsigned int index = hash & ((1u << eh_info->globalDepth) - 1);
+        int bucket;
+        if (dir_get(eh_info, index, &bucket) == -1){
+            return -1;
+        }
+        if (BF_GetBlock(eh_info->fileDesc, bucket, block) != BF_OK){
+            return -1;
+        }
+        void *data = BF_Block_GetData(block);
+        EH_block_info *block_info = data + NEXT;
+
+        if (block_info->recordsCounter < MAX_REC){
+            memcpy(data + sizeof(Record)*block_info->recordsCounter, &record, sizeof(Record));
+            block_info->recordsCounter++;
+            BF_Block_SetDirty(block);
+            if (BF_UnpinBlock(block) != BF_OK){
+                return -1;
+            }
+            return bucket;
+        }
+
+        /* A full bucket splits, the directory doubles first when the bucket
+           already uses all of its bits */
+        int code = 0;
+        if (block_info->localDepth == eh_info->globalDepth){
+            if (eh_info->globalDepth == EH_MAX_DEPTH){
+                code = -1;
+            } else {
+                code = dir_double(eh_info);
+            }
+        }
+        if (code == 0){
+            code = bucket_split(eh_info, index, block);
+        }
+        BF_Block_SetDirty(block);
+        if (BF_UnpinBlock(block) != BF_OK || code == -1){
+            return -1;
+        }
+    }
+}
+
+
+int EH_GetAllEntries(EH_info* eh_info, void *value){
+    int id = *(int *)value;
+    unsigned int index = eh_hash(id) & ((1u << eh_info->globalDepth) - 1);
+
+    /* One directory probe */
+    int bucket;
+    if (dir_get(eh_info, index, &bucket) == -1){
+        return -1;
+    }
+
+    /* And one bucket, the handle lives on the stack */
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    if (BF_GetBlock(eh_info->fileDesc, bucket, block) != BF_OK){
+        return -1;
+    }
+    void *data = BF_Block_GetData(block);
+    EH_block_info *block_info = data + NEXT;
+    int found = 0;
+    for (int i = 0; i < block_info->recordsCounter; i++){
+        Record *record = data + sizeof(Record)*i;
+        if (record->id == id){
+            printRecord(*record);
+            found = 1;
+        }
+    }
+    if (BF_UnpinBlock(block) != BF_OK){
+        return -1;
+    }
+    return found ? 1 : -1;
+}
+
+
+int EH_HashStatistics(EH_info* eh_info){
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    int min = -1, max = 0;
+    long records = 0;
+
+    /* Each bucket is counted at its lowest directory entry, the one below 2^localDepth */
+    for (unsigned int i = 0; i < 1u << eh_info->globalDepth; i++){
+        int bucket;
+        if (dir_get(eh_info, i, &bucket) == -1 || BF_GetBlock(eh_info->fileDesc, bucket, block) != BF_OK){
+            return -1;
+        }
+        EH_block_info *block_info = (void *)BF_Block_GetData(block) + NEXT;
+        if (i < 1u << block_info->localDepth){
+            int count = block_info->recordsCounter;
+            records += count;
+            if (min == -1 || count < min){
+                min = count;
+            }
+            if (count > max){
+                max = count;
+            }
+        }
+        if (BF_UnpinBlock(block) != BF_OK){
+            return -1;
+        }
+    }
+
+    int blocks;
+    if (BF_GetBlockCounter(eh_info->fileDesc, &blocks) != BF_OK){
+        return -1;
+    }
+    printf("-----------------------------------------------------------------\n");
+    printf("                  Extendible Hash Table Statistics                 \n");
+    printf("                \n");
+    printf("the number of blocks in this file is : %d\n", blocks);
+    printf("global depth %d, %u directory entries in %d blocks\n",
+           eh_info->globalDepth, 1u << eh_info->globalDepth, eh_info->dirBlocks);
+    printf("%d buckets, %d splits, %d directory doublings\n",
+           eh_info->buckets, eh_info->splits, eh_info->doublings);
+    printf("max record sum = %d\n", max);
+    printf("min record sum = %d\n", min);
+    printf("avg record sum = %ld\n", records / eh_info->buckets);
+    printf("-----------------------------------------------------------------\n");
+    return 0;
+}
@@ -1,6 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <limits.h>
+#include <stddef.h>
+#include <time.h>
 
 #include "bf.h"
 #include "hp_file.h"
@@ -14,11 +20,579 @@
     return HP_ERROR;        \
   }                         \
 }
-#define NEXT    BF_BLOCK_SIZE-sizeof(HP_block_info)
-#define MAX_REC (BF_BLOCK_SIZE-sizeof(HP_block_info))/sizeof(Record)
+#define NEXT    (BF_GetBlockSize()-sizeof(HP_block_info))
+#define MAX_REC ((BF_GetBlockSize()-sizeof(HP_block_info))/sizeof(Record))
+#define PREFETCH_BLOCKS 16
+#define EXTENT_BLOCKS 16     /* the file grows by this many blocks at a time */
+#define BULK_BLOCKS 32       /* blocks HP_BulkInsert allocates and pins at a time */
+#define MORSEL_BLOCKS 32     /* blocks a thread of HP_ParallelScan takes at a time */
+#define MAX_SCAN_THREADS 64
+#define ZONE_SUFFIX ".zm"    /* the zone map of file name is kept in name.zm */
+#define DICT_SUFFIX ".dict"  /* and the dictionaries of a HP_LAYOUT_DICT file in name.dict */
+#define DICT_REC ((BF_GetBlockSize()-sizeof(HP_block_info))/sizeof(HP_Code))
+#define TUPLE_MIN (sizeof(int) + HP_DICT_COLUMNS)    /* a tuple with empty strings */
+#define SLOTTED_REC ((NEXT - sizeof(HP_Page)) / (sizeof(HP_Slot) + TUPLE_MIN))
+
+#if !defined(HP_NO_SIMD) && (defined(__x86_64__) || defined(__i386__))
+#define HP_HAVE_SIMD
+#include <immintrin.h>
+#endif
+
+/* A PAX block keeps the same MAX_REC records as a row block, but each field
+   of them as one column: the ids, then the names, the surnames, the cities
+   and the record tags, each value at the fixed width of its field */
+#define FIELD_WIDTH(field) sizeof(((Record *)0)->field)
+#define PAX_IDS(data)      ((int *)(data))
+#define PAX_NAMES(data)    ((char *)(data) + MAX_REC*sizeof(int))
+#define PAX_SURNAMES(data) (PAX_NAMES(data) + MAX_REC*FIELD_WIDTH(name))
+#define PAX_CITIES(data)   (PAX_SURNAMES(data) + MAX_REC*FIELD_WIDTH(surname))
+#define PAX_TAGS(data)     (PAX_CITIES(data) + MAX_REC*FIELD_WIDTH(city))
+
+/* A record of a HP_LAYOUT_DICT block: the id and the dictionary code of
+   each text field, in the column order of HP_Dictionary */
+typedef struct {
+    int id;
+    unsigned char codes[HP_DICT_COLUMNS];
+} HP_Code;
+
+/* The field of the record that column c of the dictionaries keeps */
+static char *record_field(Record *record, int c, size_t *width){
+    switch (c){
+        case NAME:
+            *width = FIELD_WIDTH(name);
+            return record->name;
+        case SURNAME:
+            *width = FIELD_WIDTH(surname);
+            return record->surname;
+        case CITY:
+            *width = FIELD_WIDTH(city);
+            return record->city;
+        default:
+            *width = FIELD_WIDTH(record);
+            return record->record;
+    }
+}
+
+/* Find the codes of the text fields of the record, values the dictionaries
+   do not have yet are added. Returns -1 when a column is full */
+static int dict_encode(HP_Dictionary *dict, const Record *record, HP_Code *code){
+    code->id = record->id;
+    for (int c = 0; c < HP_DICT_COLUMNS; c++){
+        size_t width;
+        const char *field = record_field((Record *)record, c, &width);
+        int k = 0;
+        while (k < dict->counts[c] && strncmp(dict->values[c][k], field, width) != 0){
+            k++;
+        }
+        if (k == dict->counts[c]){
+            if (k == HP_DICT_SIZE){
+                return -1;
+            }
+            memset(dict->values[c][k], 0, HP_DICT_WIDTH);
+            memcpy(dict->values[c][k], field, strnlen(field, width));
+            dict->counts[c]++;
+        }
+        code->codes[c] = k;
+    }
+    return 0;
+}
+
+/* Whether dict_encode would take the record, a value that is not in a full
+   column yet has no code */
+static int dict_has_room(const HP_Dictionary *dict, const Record *record){
+    for (int c = 0; c < HP_DICT_COLUMNS; c++){
+        if (dict->counts[c] < HP_DICT_SIZE){
+            continue;
+        }
+        size_t width;
+        const char *field = record_field((Record *)record, c, &width);
+        int k = 0;
+        while (k < dict->counts[c] && strncmp(dict->values[c][k], field, width) != 0){
+            k++;
+        }
+        if (k == dict->counts[c]){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Put together the record of the codes, only when a caller asks for it */
+static void dict_decode(const HP_Dictionary *dict, const HP_Code *code, Record *record){
+    record->id = code->id;
+    for (int c = 0; c < HP_DICT_COLUMNS; c++){
+        size_t width;
+        char *field = record_field(record, c, &width);
+        memcpy(field, dict->values[c][code->codes[c]], width);
+    }
+}
+
+/* Whether the result of a comparison satisfies compare */
+static int compare_matches(int cmp, Record_Compare compare){
+    switch (compare){
+        case EQUAL:         return cmp == 0;
+        case NOT_EQUAL:     return cmp != 0;
+        case LESS:          return cmp < 0;
+        case LESS_EQUAL:    return cmp <= 0;
+        case GREATER:       return cmp > 0;
+        case GREATER_EQUAL: return cmp >= 0;
+    }
+    return 0;
+}
+
+/* A HP_LAYOUT_SLOTTED block starts with a HP_Page and its slot directory,
+   one HP_Slot per record, which grows towards the end of the block. The
+   tuples are packed from the footer down. A tuple is the id followed by
+   each text field as one byte of length and its characters, without the
+   padding of the Record arrays */
+typedef struct {
+    uint16_t tuples;    /* where the lowest tuple starts, 0 in a zeroed block */
+    uint16_t holes;     /* bytes of tuples that were given up, for compaction */
+} HP_Page;
+
+typedef struct {
+    uint16_t offset;
+    uint16_t length;    /* 0 for a slot without a tuple */
+} HP_Slot;
+
+#define PAGE(data)  ((HP_Page *)(data))
+#define SLOTS(data) ((HP_Slot *)((char *)(data) + sizeof(HP_Page)))
+
+/* The start of the tuples of the block, a zeroed block has none yet */
+static size_t page_tuples(const void *data){
+    return PAGE(data)->tuples != 0 ? PAGE(data)->tuples : NEXT;
+}
+
+/* The bytes of a tuple of the record */
+static size_t tuple_size(const Record *record){
+    size_t size = sizeof(int);
+    for (int c = 0; c < HP_DICT_COLUMNS; c++){
+        size_t width;
+        const char *field = record_field((Record *)record, c, &width);
+        size += 1 + strnlen(field, width);
+    }
+    return size;
+}
+
+static void tuple_encode(const Record *record, unsigned char *tuple){
+    memcpy(tuple, &record->id, sizeof(int));
+    tuple += sizeof(int);
+    for (int c = 0; c < HP_DICT_COLUMNS; c++){
+        size_t width;
+        const char *field = record_field((Record *)record, c, &width);
+        size_t length = strnlen(field, width);
+        *tuple = length;
+        memcpy(tuple + 1, field, length);
+        tuple += 1 + length;
+    }
+}
+
+static void tuple_decode(const unsigned char *tuple, Record *record){
+    memcpy(&record->id, tuple, sizeof(int));
+    tuple += sizeof(int);
+    for (int c = 0; c < HP_DICT_COLUMNS; c++){
+        size_t width;
+        char *field = record_field(record, c, &width);
+        memcpy(field, tuple + 1, *tuple);
+        memset(field + *tuple, 0, width - *tuple);
+        tuple += 1 + *tuple;
+    }
+}
+
+/* Whether the tuple satisfies the predicate, only the field it names is read */
+static int tuple_matches(const unsigned char *tuple, const Record_Predicate *predicate){
+    if (predicate->attribute == ID){
+        int id;
+        memcpy(&id, tuple, sizeof(int));
+        return compare_matches((id > predicate->id) - (id < predicate->id), predicate->compare);
+    }
+    tuple += sizeof(int);
+    for (int c = 0; c < (int)predicate->attribute; c++){
+        tuple += 1 + *tuple;
+    }
+    Record record;
+    size_t width;
+    record_field(&record, predicate->attribute, &width);
+
+    /* strncmp of the padded field, without putting it together */
+    size_t length = *tuple;
+    size_t value_length = strnlen(predicate->value, width);
+    int cmp = memcmp(tuple + 1, predicate->value, length < value_length ? length : value_length);
+    if (cmp == 0){
+        cmp = (length > value_length) - (length < value_length);
+    }
+    return compare_matches(cmp, predicate->compare);
+}
+
+/* At most how many records a block of the file holds */
+static size_t block_records(const HP_info *hp_info){
+    switch (hp_info->layout){
+        case HP_LAYOUT_DICT:    return DICT_REC;
+        case HP_LAYOUT_SLOTTED: return SLOTTED_REC;
+        default:                return MAX_REC;
+    }
+}
+
+/* Whether the record fits in the block next to the ones it has */
+static int block_has_room(const HP_info *hp_info, const void *data, const Record *record){
+    const HP_block_info *block_info = data + NEXT;
+    if (hp_info->layout != HP_LAYOUT_SLOTTED){
+        return block_info->rec_count < block_records(hp_info);
+    }
+    size_t directory = sizeof(HP_Page) + (block_info->rec_count + 1) * sizeof(HP_Slot);
+    return directory + tuple_size(record) <= page_tuples(data);
+}
+
+/* Whether put_record can store the record, checked before a new block is
+   added for it so that a refused record does not leave an empty tail */
+static int record_encodes(const HP_info *hp_info, const Record *record){
+    return hp_info->layout != HP_LAYOUT_DICT || dict_has_room(hp_info->dict, record);
+}
+
+/* Write the record in place slot of the block. Returns -1 when the
+   dictionaries of a HP_LAYOUT_DICT file have no room for its values */
+static int put_record(const HP_info *hp_info, void *data, size_t slot, const Record *record){
+    if (hp_info->layout == HP_LAYOUT_ROW){
+        memcpy(data + sizeof(Record)*slot, record, sizeof(Record));
+        return 0;
+    }
+    if (hp_info->layout == HP_LAYOUT_DICT){
+        return dict_encode(hp_info->dict, record, (HP_Code *)data + slot);
+    }
+    if (hp_info->layout == HP_LAYOUT_SLOTTED){
+        /* The caller made sure with block_has_room that it fits */
+        size_t size = tuple_size(record);
+        size_t offset = page_tuples(data) - size;
+        tuple_encode(record, (unsigned char *)data + offset);
+        SLOTS(data)[slot].offset = offset;
+        SLOTS(data)[slot].length = size;
+        PAGE(data)->tuples = offset;
+        return 0;
+    }
+    PAX_IDS(data)[slot] = record->id;
+    memcpy(PAX_NAMES(data) + slot*FIELD_WIDTH(name), record->name, FIELD_WIDTH(name));
+    memcpy(PAX_SURNAMES(data) + slot*FIELD_WIDTH(surname), record->surname, FIELD_WIDTH(surname));
+    memcpy(PAX_CITIES(data) + slot*FIELD_WIDTH(city), record->city, FIELD_WIDTH(city));
+    memcpy(PAX_TAGS(data) + slot*FIELD_WIDTH(record), record->record, FIELD_WIDTH(record));
+    return 0;
+}
+
+/* Put together the record in place slot of a PAX block */
+static void get_pax_record(const void *data, size_t slot, Record *record){
+    record->id = PAX_IDS(data)[slot];
+    memcpy(record->name, PAX_NAMES(data) + slot*FIELD_WIDTH(name), FIELD_WIDTH(name));
+    memcpy(record->surname, PAX_SURNAMES(data) + slot*FIELD_WIDTH(surname), FIELD_WIDTH(surname));
+    memcpy(record->city, PAX_CITIES(data) + slot*FIELD_WIDTH(city), FIELD_WIDTH(city));
+    memcpy(record->record, PAX_TAGS(data) + slot*FIELD_WIDTH(record), FIELD_WIDTH(record));
+}
+
+
+/* The start of a zone file, the zones follow it. The map is only trusted
+   for the heap file with the same identity and last block */
+typedef struct {
+    unsigned long long file_id;
+    int last;
+} HP_ZoneHeader;
+
+/* An identity for a new heap file, never 0 */
+static unsigned long long new_file_id(void){
+    static unsigned long long created;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    unsigned long long id = (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    id ^= (unsigned long long)getpid() << 40;
+    id += __atomic_add_fetch(&created, 1, __ATOMIC_RELAXED);
+    id *= 0x9E3779B97F4A7C15ULL;
+    return id != 0 ? id : 1;
+}
+
+/* The side file of the heap file fileName with the given suffix */
+static void side_file_name(char *side_name, size_t size, const char *fileName, const char *suffix){
+    snprintf(side_name, size, "%s%s", fileName, suffix);
+}
+
+/* Copy n bytes at offset of a side file to buf, or from buf when write is
+   set, with the blocks of the file laid out as one array of bytes. A zone
+   file is a HP_ZoneHeader followed by one HP_Zone per block, a dictionary
+   file is the HP_Dictionary */
+static int side_io(int sideDesc, size_t offset, void *buf, size_t n, int write){
+    size_t block_size = BF_GetBlockSize();
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    while (n > 0){
+        int block_num = offset / block_size;
+        size_t skip = offset % block_size;
+        size_t length = block_size - skip < n ? block_size - skip : n;
+
+        int blocks_num;
+        if (BF_GetBlockCounter(sideDesc, &blocks_num) != BF_OK){
+            return -1;
+        }
+        if (block_num >= blocks_num){
+            if (!write || BF_AllocateBlocks(sideDesc, block_num + 1 - blocks_num, NULL, NULL) != BF_OK){
+                return -1;
+            }
+        }
+        if (BF_GetBlock(sideDesc, block_num, block) != BF_OK){
+            return -1;
+        }
+        char *data = BF_Block_GetData(block);
+        if (write){
+            memcpy(data + skip, buf, length);
+            BF_Block_SetDirty(block);
+        } else {
+            memcpy(buf, data + skip, length);
+        }
+        if (BF_UnpinBlock(block) != BF_OK){
+            return -1;
+        }
+        offset += length;
+        buf = (char *)buf + length;
+        n -= length;
+    }
+    return 0;
+}
+
+/* Make room in the zone map for the entry of block_num, new entries are empty */
+static int zone_reserve(HP_info *hp_info, int block_num){
+    if (block_num < hp_info->zone_capacity){
+        return 0;
+    }
+    int capacity = hp_info->zone_capacity == 0 ? 1024 : hp_info->zone_capacity;
+    while (capacity <= block_num){
+        capacity *= 2;
+    }
+    HP_Zone *zones = realloc(hp_info->zones, capacity * sizeof(HP_Zone));
+    if (zones == NULL){
+        return -1;
+    }
+    for (int b = hp_info->zone_capacity; b < capacity; b++){
+        zones[b].min_id = INT_MAX;
+        zones[b].max_id = INT_MIN;
+    }
+    hp_info->zones = zones;
+    hp_info->zone_capacity = capacity;
+    return 0;
+}
+
+/* The first change of the session marks the saved map stale, so that a
+   session that does not get to HP_CloseFile leaves a map that is rebuilt */
+static void zone_change(HP_info *hp_info){
+    hp_info->zone_dirty = 1;
+    int stale = -1;
+    if (hp_info->zoneDesc != -1
+        && side_io(hp_info->zoneDesc, offsetof(HP_ZoneHeader, last), &stale, sizeof(int), 1) == -1){
+        hp_info->zoned = 0;
+    }
+}
+
+/* Widen the zone of block_num to the id of a record stored in it */
+static void zone_add(HP_info *hp_info, int block_num, int id){
+    if (!hp_info->zoned){
+        return;
+    }
+    if (!hp_info->zone_dirty){
+        zone_change(hp_info);
+    }
+    if (zone_reserve(hp_info, block_num) == -1){
+        hp_info->zoned = 0;     /* the map misses a block, no scan may trust it */
+        return;
+    }
+    HP_Zone *zone = &hp_info->zones[block_num];
+    if (id < zone->min_id){
+        zone->min_id = id;
+    }
+    if (id > zone->max_id){
+        zone->max_id = id;
+    }
+}
+
+/* Whether block_num may hold a record that satisfies the predicate, a block
+   without a zone always may */
+static int zone_may_match(const HP_info *hp_info, int block_num, const Record_Predicate *predicate){
+    if (predicate == NULL || predicate->attribute != ID || !hp_info->zoned || !hp_info->zone_skip
+        || block_num >= hp_info->zone_capacity){
+        return 1;
+    }
+    const HP_Zone *zone = &hp_info->zones[block_num];
+    if (zone->min_id > zone->max_id){
+        return 0;   /* no records */
+    }
+    int id = predicate->id;
+    switch (predicate->compare){
+        case EQUAL:         return zone->min_id <= id && id <= zone->max_id;
+        case NOT_EQUAL:     return zone->min_id != id || zone->max_id != id;
+        case LESS:          return zone->min_id < id;
+        case LESS_EQUAL:    return zone->min_id <= id;
+        case GREATER:       return zone->max_id > id;
+        case GREATER_EQUAL: return zone->max_id >= id;
+    }
+    return 1;
+}
+
+/* Read the zone map of every block of the heap file, when it was kept */
+static int zone_rebuild(HP_info *hp_info){
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    for (int b = 1; b <= hp_info->last; b++){
+        if (BF_GetBlock(hp_info->fileDesc, b, block) != BF_OK){
+            return -1;
+        }
+        void *data = BF_Block_GetData(block);
+        HP_block_info *block_info = data + NEXT;
+        for (int i = 0; i < block_info->rec_count; i++){
+            int id;
+            if (hp_info->layout == HP_LAYOUT_PAX){
+                id = PAX_IDS(data)[i];
+            } else if (hp_info->layout == HP_LAYOUT_DICT){
+                id = ((HP_Code *)data)[i].id;
+            } else if (hp_info->layout == HP_LAYOUT_SLOTTED){
+                if (SLOTS(data)[i].length == 0){
+                    continue;
+                }
+                memcpy(&id, (char *)data + SLOTS(data)[i].offset, sizeof(int));
+            } else {
+                id = ((Record *)data)[i].id;
+            }
+            zone_add(hp_info, b, id);
+        }
+        if (BF_UnpinBlock(block) != BF_OK){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Bring the zone map into memory. A map saved for another file or another
+   last block, or a file without one, is built again from the blocks. The
+   side file is not created here, only HP_CloseFile creates it and only when
+   the session changed the map, so an open that only reads writes nothing */
+static void zone_open(HP_info *hp_info, const char *fileName){
+    hp_info->zones = NULL;
+    hp_info->zone_capacity = 0;
+    hp_info->zoneDesc = -1;
+    hp_info->zoned = 0;
+    hp_info->zone_dirty = 0;
+    hp_info->zone_skip = 1;
+    size_t size = strlen(fileName) + sizeof(ZONE_SUFFIX);
+    hp_info->zone_name = malloc(size);
+    if (hp_info->zone_name == NULL){
+        return;
+    }
+    side_file_name(hp_info->zone_name, size, fileName, ZONE_SUFFIX);
+    if (access(hp_info->zone_name, F_OK) != 0
+        || BF_OpenFile(hp_info->zone_name, &hp_info->zoneDesc) != BF_OK){
+        hp_info->zoneDesc = -1;
+    }
+
+    HP_ZoneHeader header;
+    if (hp_info->zoneDesc != -1
+        && side_io(hp_info->zoneDesc, 0, &header, sizeof(header), 0) == 0
+        && header.file_id == hp_info->file_id && header.last == hp_info->last
+        && zone_reserve(hp_info, hp_info->last) == 0
+        && side_io(hp_info->zoneDesc, sizeof(HP_ZoneHeader), hp_info->zones,
+                   (hp_info->last + 1) * sizeof(HP_Zone), 0) == 0){
+        hp_info->zoned = 1;
+        return;
+    }
+
+    /* Whatever was read of a stale map does not count */
+    free(hp_info->zones);
+    hp_info->zones = NULL;
+    hp_info->zone_capacity = 0;
+    hp_info->zoned = 1;
+    if (zone_rebuild(hp_info) == -1){
+        free(hp_info->zones);
+        hp_info->zones = NULL;
+        hp_info->zone_capacity = 0;
+        hp_info->zoned = 0;
+    }
+    /* A stale side file is written again, a missing one waits for a change */
+    hp_info->zone_dirty = hp_info->zoned && hp_info->zoneDesc != -1;
+}
+
+/* Write the zone map back to its file, if it changed, and close it */
+static int zone_close(HP_info *hp_info){
+    int code = 0;
+    if (hp_info->zoned && hp_info->zone_dirty){
+        HP_ZoneHeader header;
+        memset(&header, 0, sizeof(header));
+        header.file_id = hp_info->file_id;
+        header.last = hp_info->last;
+        if (hp_info->zoneDesc == -1
+            && (BF_CreateFile(hp_info->zone_name) != BF_OK
+                || BF_OpenFile(hp_info->zone_name, &hp_info->zoneDesc) != BF_OK)){
+            hp_info->zoneDesc = -1;
+            code = -1;
+        } else if (zone_reserve(hp_info, hp_info->last) == -1
+            || side_io(hp_info->zoneDesc, sizeof(HP_ZoneHeader), hp_info->zones,
+                       (hp_info->last + 1) * sizeof(HP_Zone), 1) == -1
+            || side_io(hp_info->zoneDesc, 0, &header, sizeof(header), 1) == -1){
+            code = -1;
+        }
+    }
+    free(hp_info->zones);
+    hp_info->zones = NULL;
+    hp_info->zone_capacity = 0;
+    hp_info->zoned = 0;
+    free(hp_info->zone_name);
+    hp_info->zone_name = NULL;
+    if (hp_info->zoneDesc != -1 && BF_CloseFile(hp_info->zoneDesc) != BF_OK){
+        code = -1;
+    }
+    hp_info->zoneDesc = -1;
+    return code;
+}
+
+/* Bring the dictionaries of a HP_LAYOUT_DICT file into memory, an empty
+   dictionary file is a file without records yet */
+static int dict_open(HP_info *hp_info, const char *fileName){
+    hp_info->dictDesc = -1;
+    hp_info->dict = NULL;
+    if (hp_info->layout != HP_LAYOUT_DICT){
+        return 0;
+    }
+
+    char dict_name[4096];
+    side_file_name(dict_name, sizeof(dict_name), fileName, DICT_SUFFIX);
+    hp_info->dict = malloc(sizeof(HP_Dictionary));
+    if (hp_info->dict == NULL){
+        return -1;
+    }
+    if (BF_OpenFile(dict_name, &hp_info->dictDesc) != BF_OK){
+        free(hp_info->dict);
+        hp_info->dict = NULL;
+        hp_info->dictDesc = -1;
+        return -1;
+    }
+    if (side_io(hp_info->dictDesc, 0, hp_info->dict, sizeof(HP_Dictionary), 0) == -1){
+        memset(hp_info->dict, 0, sizeof(HP_Dictionary));
+    }
+    return 0;
+}
+
+/* Write the dictionaries back to their file and close it */
+static int dict_close(HP_info *hp_info){
+    if (hp_info->dictDesc == -1){
+        return 0;
+    }
+    int code = side_io(hp_info->dictDesc, 0, hp_info->dict, sizeof(HP_Dictionary), 1);
+    free(hp_info->dict);
+    hp_info->dict = NULL;
+    if (BF_CloseFile(hp_info->dictDesc) != BF_OK){
+        code = -1;
+    }
+    hp_info->dictDesc = -1;
+    return code;
+}
 
 
 int HP_CreateFile(char *fileName){
+    return HP_CreateFileLayout(fileName, HP_LAYOUT_ROW);
+}
+
+
+int HP_CreateFileLayout(char *fileName, HP_Layout layout){
 
     /*Create file in block - level*/
     if (BF_CreateFile(fileName) == BF_ERROR) {      
@@ -46,7 +620,10 @@ int HP_CreateFile(char *fileName){
     
     hp_info->fileDesc=fileDesc;
     hp_info->last=0;
+    hp_info->appending=0;
+    hp_info->layout=layout;
     hp_info->first_block=block;
+    hp_info->file_id=new_file_id();
 
     /* hp block info */
     /* Store hp_block_info at the end of first block */
@@ -67,9 +644,28 @@ int HP_CreateFile(char *fileName){
     BF_Block_Destroy(&block);
     BF_CloseFile(fileDesc);
 
+    /* A zone map or dictionaries left over from an older file of the same name are stale */
+    char side_name[4096];
+    side_file_name(side_name, sizeof(side_name), fileName, ZONE_SUFFIX);
+    remove(side_name);
+    side_file_name(side_name, sizeof(side_name), fileName, DICT_SUFFIX);
+    remove(side_name);
+    if (layout == HP_LAYOUT_DICT && BF_CreateFile(side_name) != BF_OK){
+        return -1;
+    }
+
     return 0;
 }
 
+int HP_RemoveFile(char *fileName){
+    char side_name[4096];
+    side_file_name(side_name, sizeof(side_name), fileName, ZONE_SUFFIX);
+    remove(side_name);
+    side_file_name(side_name, sizeof(side_name), fileName, DICT_SUFFIX);
+    remove(side_name);
+    return remove(fileName) == 0 ? 0 : -1;
+}
+
 
 HP_info* HP_OpenFile(char *fileName){
     /* Get the file identifier with BF_OpenFile */
@@ -78,14 +674,9 @@ HP_info* HP_OpenFile(char *fileName){
         return NULL;
     }
 
-    /*Read the header_block*/
+    /*Read the header_block, it stays pinned until HP_CloseFile*/
     BF_Block *block;
     BF_Block_Init(&block);
-    if (BF_AllocateBlock(fileDesc, block) == BF_ERROR) {
-        return NULL;
-    }
-
-
     if (BF_GetBlock(fileDesc,0, block) == BF_ERROR){
         return NULL;
     }
@@ -99,12 +690,47 @@ HP_info* HP_OpenFile(char *fileName){
 
     memcpy(info, header_info, sizeof(HP_info));
 
+    /* The descriptor and the handle stored in the header belong to the run that created the file */
+    info->fileDesc = fileDesc;
+    info->first_block = block;
+    info->appending = 0;
+    if (info->file_id == 0){
+        info->file_id = new_file_id();    /* a file from before the identities */
+    }
+    if (dict_open(info, fileName) == -1){
+        BF_UnpinBlock(block);
+        BF_Block_Destroy(&block);
+        BF_CloseFile(fileDesc);
+        free(info);
+        return NULL;
+    }
+    zone_open(info, fileName);
+
     return info ;
 }
 
 
 int HP_CloseFile( HP_info* hp_info ){
 
+    /* An append cursor that is still open gives its tail back first */
+    if (hp_info->appending && HP_EndAppend(hp_info) == -1) {
+        return -1;
+    }
+
+    if (zone_close(hp_info) == -1 || dict_close(hp_info) == -1) {
+        return -1;
+    }
+
+    /* Keep the last block in the header for the next HP_OpenFile */
+    HP_info *header_info = (HP_info *)BF_Block_GetData(hp_info->first_block);
+    header_info->last = hp_info->last;
+    header_info->file_id = hp_info->file_id;
+    BF_Block_SetDirty(hp_info->first_block);
+    if (BF_UnpinBlock(hp_info->first_block) == BF_ERROR) {
+        return -1;
+    }
+    BF_Block_Destroy(&hp_info->first_block);
+
     if (BF_CloseFile(hp_info->fileDesc) == BF_ERROR) {
         return -1;
     }
@@ -113,14 +739,47 @@ int HP_CloseFile( HP_info* hp_info ){
     return 0;
 }
 
+int HP_UseZoneMap(HP_info* hp_info, int use){
+    hp_info->zone_skip = use != 0;
+    return 0;
+}
+
+/* Add one more block at the end of the file. It becomes hp_info->last, it
+   is pinned in block and it has no records yet */
+static int new_last_block(HP_info *hp_info, BF_Block *block){
+
+    /* The file grows by extents, the next block may be allocated already */
+    int blocks_num;
+    if (BF_GetBlockCounter(hp_info->fileDesc, &blocks_num) != BF_OK){
+        return -1;
+    }
+    if (hp_info->last + 1 >= blocks_num) {
+        if (BF_AllocateBlocks(hp_info->fileDesc, EXTENT_BLOCKS, NULL, NULL) != BF_OK){
+            return -1;
+        }
+    }
+
+    /* last moves only once the block is there to initialise */
+    if (BF_GetBlock(hp_info->fileDesc, hp_info->last + 1, block) != BF_OK){
+        return -1;
+    }
+    hp_info->last++;
+
+    /* Create block info for my new block */
+    HP_block_info *block_info = (void *)BF_Block_GetData(block) + NEXT;
+    block_info->rec_count=0;
+    block_info->next_block=NULL;
+    return 0;
+}
+
 int HP_InsertEntry(HP_info* hp_info, Record record){
     /* 1st block does not contain any records */
     /* Check if my record can be in last block or else create new one */
     
-    BF_Block *last_block;
-    BF_Block_Init(&last_block);
+    /* The handles live in hp_info, an insert does not allocate memory */
+    BF_Block *last_block = BF_Block_InitIn(&hp_info->handles[0]);
     
-    if (BF_GetBlock(hp_info->fileDesc,hp_info->last, last_block) == BF_ERROR) {
+    if (BF_GetBlock(hp_info->fileDesc,hp_info->last, last_block) != BF_OK) {
         return -1;
     }
     
@@ -131,61 +790,171 @@ int HP_InsertEntry(HP_info* hp_info, Record record){
 
     if (hp_info->last != 0){
 
-        if(last_block_info->rec_count<MAX_REC){
+        if(block_has_room(hp_info, data, &record)){
             /* insert the record inside last block, enough space */
-            memcpy(data+sizeof(Record)*(last_block_info->rec_count), &record, sizeof(Record));
+            if (put_record(hp_info, data, last_block_info->rec_count, &record) == -1){
+                BF_UnpinBlock(last_block);
+                return -1;
+            }
             last_block_info->rec_count++;
+            zone_add(hp_info, hp_info->last, record.id);
+            BF_Block_SetDirty(last_block);
+            if (BF_UnpinBlock(last_block) != BF_OK){
+                return -1;
+            }
             return hp_info->last;
         }
     }
         
     /* if the last block==first block or last block is full we create a new one */
-    /* Create a new block and insert this first record */
-    BF_Block *new_block;
-    BF_Block_Init(&new_block);
-    if (BF_AllocateBlock(hp_info->fileDesc, new_block) == BF_ERROR){
+    if (!record_encodes(hp_info, &record)){
+        BF_UnpinBlock(last_block);
         return -1;
     }
-    
-    
-    /* Add one more block */
-    hp_info->last++;
-    if (BF_GetBlock(hp_info->fileDesc,hp_info->last, new_block) == BF_ERROR){
+    /* Create a new block and insert this first record */
+    BF_Block *new_block = BF_Block_InitIn(&hp_info->handles[1]);
+
+    if (new_last_block(hp_info, new_block) == -1){
+        BF_UnpinBlock(last_block);
         return -1;
     }
-
-    
-    /* Create block info for my new block */
     data = BF_Block_GetData(new_block);
     HP_block_info *new_block_info = data+ NEXT;
-    new_block_info->rec_count=0;
-    new_block_info->next_block=NULL;
 
-
-    /* Point my new block in the previous one */
-    last_block_info->next_block=new_block;
-    BF_Block* test=last_block_info->next_block;
-    data = BF_Block_GetData(test);
-    HP_block_info *tester = data+ NEXT;
-    
-
-    /* Insert the record in the block */
-    memcpy(data+sizeof(Record)*(new_block_info->rec_count), &record, sizeof(Record));
+    /* Insert the record in the block, record_encodes made sure it fits */
+    put_record(hp_info, data, new_block_info->rec_count, &record);
     new_block_info->rec_count++;
+    zone_add(hp_info, hp_info->last, record.id);
    
 
     /* New block */
     /* Because we changed the (initially empty) data of the first block */
     BF_Block_SetDirty(new_block); 
-    if (BF_UnpinBlock(new_block)== BF_ERROR){
+    if (BF_UnpinBlock(new_block) != BF_OK){
+        BF_UnpinBlock(last_block);
         return -1;
     }
     
     
     /* Because we changed the (initially empty) data of the first block */
-    if(hp_info->last!=0){
-        BF_Block_SetDirty(last_block);
-        if (BF_UnpinBlock(last_block)== BF_ERROR){
+    BF_Block_SetDirty(last_block);
+    if (BF_UnpinBlock(last_block) != BF_OK){
+        return -1;
+    }
+
+    return hp_info->last;
+}
+
+/* Copy as many of the records after the first *done of the n as fit in
+   block block_num, count them once in its footer and add them to *done.
+   Returns -1 when the dictionaries had no room for one of them */
+static int fill_block(HP_info *hp_info, int block_num, BF_Block *block, const Record *records, size_t n, size_t *done){
+    void *data = BF_Block_GetData(block);
+    HP_block_info *block_info = data + NEXT;
+    records += *done;
+    size_t count = 0;
+    int code = 0;
+    if (hp_info->layout == HP_LAYOUT_ROW){
+        count = MAX_REC - block_info->rec_count;
+        if (count > n - *done){
+            count = n - *done;
+        }
+        memcpy(data + sizeof(Record)*block_info->rec_count, records, count*sizeof(Record));
+        block_info->rec_count += count;
+    } else {
+        while (count < n - *done && block_has_room(hp_info, data, &records[count])){
+            if (put_record(hp_info, data, block_info->rec_count, &records[count]) == -1){
+                code = -1;
+                break;
+            }
+            block_info->rec_count++;
+            count++;
+        }
+    }
+    for (size_t i = 0; i < count; i++){
+        zone_add(hp_info, block_num, records[i].id);
+    }
+    BF_Block_SetDirty(block);
+    *done += count;
+    return code;
+}
+
+int HP_BulkInsert(HP_info* hp_info, const Record *records, size_t n){
+    /* The tail of an open append cursor would not see the new blocks */
+    if (hp_info->appending){
+        return -1;
+    }
+
+    size_t done = 0;
+    BF_Block *block = BF_Block_InitIn(&hp_info->handles[0]);
+
+    /* Top up the last block first, block 0 keeps only the header */
+    if (hp_info->last != 0 && n > 0){
+        if (BF_GetBlock(hp_info->fileDesc, hp_info->last, block) != BF_OK){
+            return -1;
+        }
+        int code = fill_block(hp_info, hp_info->last, block, records, n, &done);
+        if (BF_UnpinBlock(block) != BF_OK || code == -1){
+            return -1;
+        }
+    }
+
+    while (done < n){
+        /* A record the dictionaries refuse gets no new block */
+        if (!record_encodes(hp_info, &records[done])){
+            return -1;
+        }
+        int blocks_num;
+        if (BF_GetBlockCounter(hp_info->fileDesc, &blocks_num) != BF_OK){
+            return -1;
+        }
+
+        /* Blocks an earlier extent allocated past the last one are used first */
+        if (hp_info->last + 1 < blocks_num){
+            if (new_last_block(hp_info, block) == -1){
+                return -1;
+            }
+            int code = fill_block(hp_info, hp_info->last, block, records, n, &done);
+            if (BF_UnpinBlock(block) != BF_OK || code == -1){
+                return -1;
+            }
+            continue;
+        }
+
+        /* Then a batch of new blocks, zeroed and pinned without a read */
+        size_t needed = (n - done + block_records(hp_info) - 1) / block_records(hp_info);
+        int batch = needed < BULK_BLOCKS ? (int)needed : BULK_BLOCKS;
+        BF_BlockStorage storage[BULK_BLOCKS];
+        BF_Block *blocks[BULK_BLOCKS];
+        for (int i = 0; i < batch; i++){
+            blocks[i] = BF_Block_InitIn(&storage[i]);
+        }
+        int first;
+        if (BF_AllocateBlocks(hp_info->fileDesc, batch, &first, blocks) != BF_OK){
+            return -1;
+        }
+        /* Blocks after the one a refused record stopped at stay past the
+           last block, as an extent that the next insert takes */
+        int code = 0;
+        int used = 0;
+        int unpinned = 1;
+        for (int i = 0; i < batch; i++){
+            if (code == 0){
+                size_t before = done;
+                code = fill_block(hp_info, first + i, blocks[i], records, n, &done);
+                if (done > before){
+                    used = i + 1;
+                }
+            }
+            /* The rest of the batch is unpinned even if one unpin fails */
+            if (BF_UnpinBlock(blocks[i]) != BF_OK){
+                unpinned = 0;
+            }
+        }
+        if (used > 0){
+            hp_info->last = first + used - 1;
+        }
+        if (code == -1 || !unpinned){
             return -1;
         }
     }
@@ -193,62 +962,677 @@ int HP_InsertEntry(HP_info* hp_info, Record record){
     return hp_info->last;
 }
 
-int HP_GetAllEntries(HP_info* hp_info, int value){
-    int count = 0;
-    int blockID = 0;
-    int block_counter = 0;
-        
+int HP_BeginAppend(HP_info* hp_info){
+    if (hp_info->appending){
+        return -1;
+    }
 
-    /* Get the block ID of first block of records */
-    BF_Block *current_block = NULL;
-    
-    BF_Block_Init(&current_block);
-    if (BF_GetBlock(hp_info->fileDesc,0, current_block) == BF_ERROR){  
+    /* The tail stays pinned until HP_EndAppend, an empty file has none yet */
+    hp_info->tail = BF_Block_InitIn(&hp_info->tail_storage);
+    if (hp_info->last != 0 && BF_GetBlock(hp_info->fileDesc, hp_info->last, hp_info->tail) != BF_OK){
         return -1;
     }
+    hp_info->appending = 1;
+    return 0;
+}
 
-    
-    /* Create block info for my new block */ 
-    void *data = BF_Block_GetData(current_block);
-    data = data ;
-    HP_block_info *current_block_info = data+NEXT;
+int HP_Append(HP_info* hp_info, const Record *record){
+    if (!hp_info->appending){
+        return -1;
+    }
 
-    blockID=0;
-    
-    int  blocks_num;
-    BF_GetBlockCounter(hp_info->fileDesc ,  &blocks_num); 
-    
-    /* Find blockID*/
-    while(blockID < hp_info->last){
-        blockID++;
-        current_block=current_block_info->next_block;
+    BF_Block *tail = hp_info->tail;
+    if (hp_info->last != 0){
+        void *data = BF_Block_GetData(tail);
+        HP_block_info *tail_info = data + NEXT;
+        if (block_has_room(hp_info, data, record)){
+            /* The common case, no call to the block level at all */
+            if (put_record(hp_info, data, tail_info->rec_count, record) == -1){
+                return -1;
+            }
+            tail_info->rec_count++;
+            zone_add(hp_info, hp_info->last, record->id);
+            return hp_info->last;
+        }
+    }
 
-        if (BF_GetBlock(hp_info->fileDesc,blockID, current_block) == BF_ERROR){
+    /* A record the dictionaries refuse gets no new tail, the cursor stays on the old one */
+    if (!record_encodes(hp_info, record)){
+        return -1;
+    }
+
+    /* The tail is full, it is written once and the cursor rolls over */
+    if (hp_info->last != 0){
+        BF_Block_SetDirty(tail);
+        if (BF_UnpinBlock(tail) != BF_OK){
             return -1;
         }
-        
-        data = BF_Block_GetData(current_block);
-       
-        current_block_info = data + NEXT;
+    }
+
+    if (new_last_block(hp_info, tail) == -1){
+        hp_info->appending = 0;
+        return -1;
+    }
+    void *data = BF_Block_GetData(tail);
+    HP_block_info *tail_info = data + NEXT;
+    put_record(hp_info, data, 0, record);
+    tail_info->rec_count = 1;
+    zone_add(hp_info, hp_info->last, record->id);
+    return hp_info->last;
+}
+
+int HP_EndAppend(HP_info* hp_info){
+    if (!hp_info->appending){
+        return -1;
+    }
+    hp_info->appending = 0;
+    if (hp_info->last == 0){
+        return 0;
+    }
+
+    BF_Block *tail = hp_info->tail;
+    BF_Block_SetDirty(tail);
+    if (BF_UnpinBlock(tail) != BF_OK){
+        return -1;
+    }
+    return 0;
+}
+
+/* Compare one field of the record with the predicate, inside the block */
+static int record_matches(const Record *record, const Record_Predicate *predicate){
+    int cmp;
+    switch (predicate->attribute){
+        case ID:
+            cmp = (record->id > predicate->id) - (record->id < predicate->id);
+            break;
+        case NAME:
+            cmp = strncmp(record->name, predicate->value, sizeof(record->name));
+            break;
+        case SURNAME:
+            cmp = strncmp(record->surname, predicate->value, sizeof(record->surname));
+            break;
+        case CITY:
+            cmp = strncmp(record->city, predicate->value, sizeof(record->city));
+            break;
+        default:
+            return 0;
+    }
+
+    return compare_matches(cmp, predicate->compare);
+}
+
+/* Whether the codes of a HP_LAYOUT_DICT record satisfy the predicate. A text
+   attribute is compared once per dictionary value: accept[k] keeps the result
+   for code k, and the codes from *accepted on are compared when first seen */
+static int code_matches(const HP_Dictionary *dict, const HP_Code *code, const Record_Predicate *predicate,
+                        unsigned char *accept, int *accepted){
+    if (predicate->attribute == ID){
+        return compare_matches((code->id > predicate->id) - (code->id < predicate->id), predicate->compare);
+    }
+    int c = predicate->attribute;
+    int k = code->codes[c];
+    Record record;
+    size_t width;
+    record_field(&record, c, &width);
+    for (; *accepted <= k; (*accepted)++){
+        int cmp = strncmp(dict->values[c][*accepted], predicate->value, width);
+        accept[*accepted] = compare_matches(cmp, predicate->compare);
+    }
+    return accept[k];
+}
+
+/* The PAX column of a text attribute and the width of its values */
+static const char *pax_column(const void *data, Record_Attribute attribute, size_t *width){
+    switch (attribute){
+        case NAME:
+            *width = FIELD_WIDTH(name);
+            return PAX_NAMES(data);
+        case SURNAME:
+            *width = FIELD_WIDTH(surname);
+            return PAX_SURNAMES(data);
+        default:
+            *width = FIELD_WIDTH(city);
+            return PAX_CITIES(data);
+    }
+}
+
+/* The filter kernels below set bit i of matches when value i of a PAX
+   column satisfies the predicate. A vector kernel returns how many values
+   it went through and leaves the rest to the scalar loop */
+
+static void filter_ids_scalar(const int *ids, int from, int n,
+                              const Record_Predicate *predicate, uint64_t *matches){
+    for (int i = from; i < n; i++){
+        int cmp = (ids[i] > predicate->id) - (ids[i] < predicate->id);
+        if (compare_matches(cmp, predicate->compare)){
+            matches[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+static void filter_strings_scalar(const char *column, size_t width, int from, int n,
+                                  const Record_Predicate *predicate, uint64_t *matches){
+    for (int i = from; i < n; i++){
+        int cmp = strncmp(column + i*width, predicate->value, width);
+        if (compare_matches(cmp, predicate->compare)){
+            matches[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+#ifdef HP_HAVE_SIMD
+/* Every comparison is one of ==, < or > on the lanes, or the opposite of it */
+static int compare_inverted(Record_Compare compare){
+    return compare == NOT_EQUAL || compare == LESS_EQUAL || compare == GREATER_EQUAL;
+}
+
+/* Eight ids per instruction */
+__attribute__((target("avx2")))
+static int filter_ids_avx2(const int *ids, int n, const Record_Predicate *predicate, uint64_t *matches){
+    __m256i value = _mm256_set1_epi32(predicate->id);
+    Record_Compare compare = predicate->compare;
+    unsigned invert = compare_inverted(compare) ? 0xff : 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8){
+        __m256i ids8 = _mm256_loadu_si256((const __m256i *)(ids + i));
+        __m256i lanes;
+        if (compare == EQUAL || compare == NOT_EQUAL){
+            lanes = _mm256_cmpeq_epi32(ids8, value);
+        } else if (compare == LESS || compare == GREATER_EQUAL){
+            lanes = _mm256_cmpgt_epi32(value, ids8);
+        } else {
+            lanes = _mm256_cmpgt_epi32(ids8, value);
+        }
+        unsigned bits = _mm256_movemask_ps(_mm256_castsi256_ps(lanes)) ^ invert;
+        matches[i / 64] |= (uint64_t)bits << (i % 64);
+    }
+    return i;
+}
+
+/* Four ids per instruction, for processors without AVX2 */
+static int filter_ids_sse(const int *ids, int n, const Record_Predicate *predicate, uint64_t *matches){
+    __m128i value = _mm_set1_epi32(predicate->id);
+    Record_Compare compare = predicate->compare;
+    unsigned invert = compare_inverted(compare) ? 0xf : 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4){
+        __m128i ids4 = _mm_loadu_si128((const __m128i *)(ids + i));
+        __m128i lanes;
+        if (compare == EQUAL || compare == NOT_EQUAL){
+            lanes = _mm_cmpeq_epi32(ids4, value);
+        } else if (compare == LESS || compare == GREATER_EQUAL){
+            lanes = _mm_cmplt_epi32(ids4, value);
+        } else {
+            lanes = _mm_cmpgt_epi32(ids4, value);
+        }
+        unsigned bits = _mm_movemask_ps(_mm_castsi128_ps(lanes)) ^ invert;
+        matches[i / 64] |= (uint64_t)bits << (i % 64);
+    }
+    return i;
+}
+
+/* A whole fixed-width value against the predicate in one 16-byte compare.
+   Only == and != on a value shorter than 16 bytes, the bytes up to and with
+   the terminating '\0' have to be equal as with strncmp */
+static int filter_strings_sse(const char *column, size_t width, int n,
+                              const Record_Predicate *predicate, uint64_t *matches){
+    size_t len = strlen(predicate->value);
+    if (len >= 16 || (predicate->compare != EQUAL && predicate->compare != NOT_EQUAL)){
+        return 0;
+    }
+    char pattern[16] = {0};
+    memcpy(pattern, predicate->value, len);
+    __m128i value = _mm_loadu_si128((const __m128i *)pattern);
+    size_t used = len + 1 < width ? len + 1 : width;
+    unsigned mask = (1u << used) - 1;
+    int invert = predicate->compare == NOT_EQUAL;
+
+    /* The load of the last value reads past it, still inside the block */
+    for (int i = 0; i < n; i++){
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(column + i*width));
+        unsigned equal = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, value));
+        if (((equal & mask) == mask) != invert){
+            matches[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+    return n;
+}
+#endif
+
+/* Find the records of a PAX block that satisfy the predicate, all of them
+   when it is NULL */
+static void pax_filter(const Record_Predicate *predicate, const void *data, int n, uint64_t *matches){
+    memset(matches, 0, (n + 63) / 64 * sizeof(uint64_t));
+    if (predicate == NULL){
+        for (int i = 0; i < n; i++){
+            matches[i / 64] |= 1ULL << (i % 64);
+        }
+        return;
+    }
+
+    int done = 0;
+    if (predicate->attribute == ID){
+#ifdef HP_HAVE_SIMD
+        if (__builtin_cpu_supports("avx2")){
+            done = filter_ids_avx2(PAX_IDS(data), n, predicate, matches);
+        } else {
+            done = filter_ids_sse(PAX_IDS(data), n, predicate, matches);
+        }
+#endif
+        filter_ids_scalar(PAX_IDS(data), done, n, predicate, matches);
+        return;
+    }
+
+    size_t width;
+    const char *column = pax_column(data, predicate->attribute, &width);
+#ifdef HP_HAVE_SIMD
+    done = filter_strings_sse(column, width, n, predicate, matches);
+#endif
+    filter_strings_scalar(column, width, done, n, predicate, matches);
+}
+
+/* Set up a scan that lives wherever the caller keeps it */
+static void scan_init(HP_Scan *scan, HP_info *hp_info, const Record_Predicate *predicate){
+    scan->info = hp_info;
+    scan->filtered = predicate != NULL;
+    if (predicate != NULL){
+        scan->predicate = *predicate;
+    }
+    scan->last = hp_info->last;
+    scan->block_num = 0;
+    scan->next_record = 0;
+    scan->prefetched = 0;
+    scan->accepted = 0;
+    scan->block = BF_Block_InitIn(&scan->storage);
+}
 
-        /* Go through the records of each block */
-        for(int j=0; j<=current_block_info->rec_count; j++){
-            Record *current_rec = data + j*sizeof(Record);
-            if(current_rec->id==value){
-                printRecord(*current_rec);
-                /* Because we changed the (initially empty) data of the first block */
-                // BF_Block_SetDirty(current_block); 
+HP_Scan* HP_ScanOpen(HP_info* hp_info, const Record_Predicate *predicate){
+    HP_Scan *scan = malloc(sizeof(HP_Scan));
+    if (scan == NULL){
+        return NULL;
+    }
+    scan_init(scan, hp_info, predicate);
+    return scan;
+}
 
-                return block_counter;
+const Record* HP_ScanNext(HP_Scan* scan){
+    int fileDesc = scan->info->fileDesc;
+    for (;;){
+        if (scan->block_num > 0){
+            /* Go through the rest of the records of the pinned block */
+            void *data = BF_Block_GetData(scan->block);
+            HP_block_info *block_info = data + NEXT;
+            if (scan->info->layout == HP_LAYOUT_PAX){
+                /* pax_filter marked the records that match, only they are put together */
+                uint64_t *matches = (uint64_t *)scan->matches;
+                while (scan->next_record < block_info->rec_count){
+                    uint64_t word = matches[scan->next_record / 64] >> (scan->next_record % 64);
+                    if (word == 0){
+                        scan->next_record = (scan->next_record / 64 + 1) * 64;
+                        continue;
+                    }
+                    scan->next_record += __builtin_ctzll(word);
+                    get_pax_record(data, scan->next_record, &scan->current);
+                    scan->next_record++;
+                    return &scan->current;
+                }
+            } else if (scan->info->layout == HP_LAYOUT_DICT){
+                /* Only the codes are compared, a record is decoded when it matches */
+                const HP_Code *codes = data;
+                while (scan->next_record < block_info->rec_count){
+                    const HP_Code *code = &codes[scan->next_record++];
+                    if (!scan->filtered || code_matches(scan->info->dict, code, &scan->predicate,
+                                                        scan->accept, &scan->accepted)){
+                        dict_decode(scan->info->dict, code, &scan->current);
+                        return &scan->current;
+                    }
+                }
+            } else if (scan->info->layout == HP_LAYOUT_SLOTTED){
+                /* A tuple is decoded only when it matches */
+                const HP_Slot *slots = SLOTS(data);
+                while (scan->next_record < block_info->rec_count){
+                    const HP_Slot *slot = &slots[scan->next_record++];
+                    const unsigned char *tuple = (unsigned char *)data + slot->offset;
+                    if (slot->length != 0 && (!scan->filtered || tuple_matches(tuple, &scan->predicate))){
+                        tuple_decode(tuple, &scan->current);
+                        return &scan->current;
+                    }
+                }
+            } else {
+                while (scan->next_record < block_info->rec_count){
+                    Record *record = data + sizeof(Record)*scan->next_record;
+                    scan->next_record++;
+                    if (!scan->filtered || record_matches(record, &scan->predicate)){
+                        return record;
+                    }
+                }
+            }
+            if (BF_UnpinBlock(scan->block) != BF_OK){
+                scan->block_num = -1;
+                return NULL;
+            }
+            if (scan->block_num == scan->last){
+                scan->block_num = -1;
             }
         }
-        
-        block_counter++;
-               
-        BF_UnpinBlock(current_block);
-                        
-                 
+        if (scan->block_num == -1 || scan->last == 0){
+            return NULL;
+        }
+
+        /* Blocks whose zone rules the predicate out are not read at all */
+        const Record_Predicate *predicate = scan->filtered ? &scan->predicate : NULL;
+        do {
+            scan->block_num++;
+        } while (scan->block_num <= scan->last && !zone_may_match(scan->info, scan->block_num, predicate));
+        if (scan->block_num > scan->last){
+            scan->block_num = -1;
+            return NULL;
+        }
+
+        /* Ask for the next blocks of the scan before we need them */
+        if (scan->block_num > scan->prefetched){
+            int prefetch[PREFETCH_BLOCKS];
+            int n = 0;
+            int b;
+            for (b = scan->block_num; b <= scan->last && n < PREFETCH_BLOCKS; b++){
+                if (zone_may_match(scan->info, b, predicate)){
+                    prefetch[n++] = b;
+                }
+            }
+            scan->prefetched = b - 1;
+            BF_Prefetch(fileDesc, prefetch, n);
+        }
+
+        if (BF_GetBlock(fileDesc, scan->block_num, scan->block) != BF_OK){
+            scan->block_num = -1;
+            return NULL;
+        }
+        scan->next_record = 0;
+        if (scan->info->layout == HP_LAYOUT_PAX){
+            void *data = BF_Block_GetData(scan->block);
+            HP_block_info *block_info = data + NEXT;
+            pax_filter(scan->filtered ? &scan->predicate : NULL, data, block_info->rec_count,
+                       (uint64_t *)scan->matches);
+        }
+    }
+}
+
+/* Give back the block of a scan that stopped before its end */
+static int scan_release(HP_Scan *scan){
+    if (scan->block_num > 0){
+        scan->block_num = -1;
+        if (BF_UnpinBlock(scan->block) != BF_OK){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int HP_ScanClose(HP_Scan* scan){
+    int code = scan_release(scan);
+    free(scan);
+    return code;
+}
+
+/* The matches one thread found in one morsel, at records[first..first+count) */
+typedef struct {
+    int morsel;
+    int worker;
+    size_t first;
+    size_t count;
+} HP_Segment;
+
+/* A thread of HP_ParallelScan and the matches it collected */
+typedef struct {
+    int index;
+    HP_info *info;
+    const Record_Predicate *predicate;
+    int *next_morsel;        /* shared by all threads, taken with an atomic add */
+    int morsels;
+    int error;
+    Record *records;
+    size_t count;
+    size_t capacity;
+    HP_Segment *segments;
+    size_t segment_count;
+    size_t segment_capacity;
+    unsigned char accept[HP_DICT_SIZE];  /* as in HP_Scan, for HP_LAYOUT_DICT */
+    int accepted;
+} HP_ScanWorker;
+
+/* Make room for one more match of the worker */
+static int worker_reserve(HP_ScanWorker *worker){
+    if (worker->count == worker->capacity){
+        size_t capacity = worker->capacity == 0 ? 1024 : 2 * worker->capacity;
+        Record *records = realloc(worker->records, capacity * sizeof(Record));
+        if (records == NULL){
+            return -1;
+        }
+        worker->records = records;
+        worker->capacity = capacity;
+    }
+    return 0;
+}
+
+/* Copy the records of the block that satisfy the predicate to the worker */
+static int worker_collect(HP_ScanWorker *worker, const void *data){
+    const HP_block_info *block_info = data + NEXT;
+    int n = block_info->rec_count;
+    if (worker->info->layout == HP_LAYOUT_PAX){
+        uint64_t matches[HP_SCAN_WORDS];
+        pax_filter(worker->predicate, data, n, matches);
+        for (int w = 0; w < (n + 63) / 64; w++){
+            for (uint64_t word = matches[w]; word != 0; word &= word - 1){
+                if (worker_reserve(worker) == -1){
+                    return -1;
+                }
+                get_pax_record(data, w * 64 + __builtin_ctzll(word), &worker->records[worker->count++]);
+            }
+        }
+        return 0;
+    }
+
+    if (worker->info->layout == HP_LAYOUT_DICT){
+        const HP_Code *codes = data;
+        for (int i = 0; i < n; i++){
+            if (worker->predicate == NULL || code_matches(worker->info->dict, &codes[i], worker->predicate,
+                                                          worker->accept, &worker->accepted)){
+                if (worker_reserve(worker) == -1){
+                    return -1;
+                }
+                dict_decode(worker->info->dict, &codes[i], &worker->records[worker->count++]);
+            }
+        }
+        return 0;
+    }
+
+    if (worker->info->layout == HP_LAYOUT_SLOTTED){
+        const HP_Slot *slots = SLOTS(data);
+        for (int i = 0; i < n; i++){
+            const unsigned char *tuple = (const unsigned char *)data + slots[i].offset;
+            if (slots[i].length != 0 && (worker->predicate == NULL || tuple_matches(tuple, worker->predicate))){
+                if (worker_reserve(worker) == -1){
+                    return -1;
+                }
+                tuple_decode(tuple, &worker->records[worker->count++]);
+            }
+        }
+        return 0;
     }
 
-    return -1;
+    for (int i = 0; i < n; i++){
+        const Record *record = data + sizeof(Record)*i;
+        if (worker->predicate == NULL || record_matches(record, worker->predicate)){
+            if (worker_reserve(worker) == -1){
+                return -1;
+            }
+            worker->records[worker->count++] = *record;
+        }
+    }
+    return 0;
+}
+
+static void *scan_worker(void *arg){
+    HP_ScanWorker *worker = arg;
+    int fileDesc = worker->info->fileDesc;
+    int last = worker->info->last;
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+
+    for (;;){
+        int morsel = __atomic_fetch_add(worker->next_morsel, 1, __ATOMIC_RELAXED);
+        if (morsel >= worker->morsels){
+            break;
+        }
+
+        /* Blocks 1..last, MORSEL_BLOCKS of them per morsel */
+        int first = 1 + morsel * MORSEL_BLOCKS;
+        int end = first + MORSEL_BLOCKS - 1 < last ? first + MORSEL_BLOCKS - 1 : last;
+        int prefetch[MORSEL_BLOCKS];
+        int n = 0;
+        for (int b = first; b <= end; b++){
+            if (zone_may_match(worker->info, b, worker->predicate)){
+                prefetch[n++] = b;
+            }
+        }
+        BF_Prefetch(fileDesc, prefetch, n);
+
+        size_t start = worker->count;
+        for (int i = 0; i < n; i++){
+            int b = prefetch[i];
+            BF_ErrorCode get = BF_GetBlock(fileDesc, b, block);
+            if (get != BF_OK){
+                BF_PrintError(get);
+                worker->error = 1;
+                return NULL;
+            }
+            int code = worker_collect(worker, BF_Block_GetData(block));
+            if (BF_UnpinBlock(block) != BF_OK || code == -1){
+                worker->error = 1;
+                return NULL;
+            }
+        }
+
+        if (worker->count > start){
+            if (worker->segment_count == worker->segment_capacity){
+                size_t capacity = worker->segment_capacity == 0 ? 64 : 2 * worker->segment_capacity;
+                HP_Segment *segments = realloc(worker->segments, capacity * sizeof(HP_Segment));
+                if (segments == NULL){
+                    worker->error = 1;
+                    return NULL;
+                }
+                worker->segments = segments;
+                worker->segment_capacity = capacity;
+            }
+            HP_Segment segment = { morsel, worker->index, start, worker->count - start };
+            worker->segments[worker->segment_count++] = segment;
+        }
+    }
+    return NULL;
+}
+
+static int compare_segments(const void *a, const void *b){
+    const HP_Segment *x = *(HP_Segment *const *)a;
+    const HP_Segment *y = *(HP_Segment *const *)b;
+    return (x->morsel > y->morsel) - (x->morsel < y->morsel);
+}
+
+int HP_ParallelScan(HP_info* hp_info, const Record_Predicate *predicate, int threads, Record **matches){
+    *matches = NULL;
+    if (threads <= 0){
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads < 1){
+        threads = 1;
+    }
+    if (threads > MAX_SCAN_THREADS){
+        threads = MAX_SCAN_THREADS;
+    }
+
+    int next_morsel = 0;
+    int morsels = (hp_info->last + MORSEL_BLOCKS - 1) / MORSEL_BLOCKS;
+    HP_ScanWorker workers[MAX_SCAN_THREADS];
+    pthread_t tids[MAX_SCAN_THREADS];
+    memset(workers, 0, threads * sizeof(HP_ScanWorker));
+
+    /* The calling thread is worker 0. The threads that start take the next
+       slots, so workers[0..started) are all the workers whatever failed */
+    int started = 0;
+    for (int t = 0; t < threads; t++){
+        HP_ScanWorker *worker = &workers[started];
+        worker->index = started;
+        worker->info = hp_info;
+        worker->predicate = predicate;
+        worker->next_morsel = &next_morsel;
+        worker->morsels = morsels;
+        if (t == 0 || pthread_create(&tids[started], NULL, scan_worker, worker) == 0){
+            started++;
+        }
+    }
+    scan_worker(&workers[0]);
+    for (int t = 1; t < started; t++){
+        pthread_join(tids[t], NULL);
+    }
+
+    /* Put the matches of all morsels together in the order of the file */
+    int error = 0;
+    size_t count = 0, segment_count = 0;
+    for (int t = 0; t < started; t++){
+        error |= workers[t].error;
+        count += workers[t].count;
+        segment_count += workers[t].segment_count;
+    }
+    HP_Segment **segments = malloc((segment_count + 1) * sizeof(HP_Segment *));
+    Record *records = malloc((count + 1) * sizeof(Record));
+    if (segments == NULL || records == NULL){
+        error = 1;
+    }
+    if (!error){
+        size_t s = 0;
+        for (int t = 0; t < started; t++){
+            for (size_t i = 0; i < workers[t].segment_count; i++){
+                segments[s++] = &workers[t].segments[i];
+            }
+        }
+        qsort(segments, segment_count, sizeof(HP_Segment *), compare_segments);
+
+        size_t copied = 0;
+        for (size_t i = 0; i < segment_count; i++){
+            HP_ScanWorker *owner = &workers[segments[i]->worker];
+            memcpy(records + copied, owner->records + segments[i]->first, segments[i]->count * sizeof(Record));
+            copied += segments[i]->count;
+        }
+    }
+
+    for (int t = 0; t < started; t++){
+        free(workers[t].records);
+        free(workers[t].segments);
+    }
+    free(segments);
+    if (error){
+        free(records);
+        return -1;
+    }
+    *matches = records;
+    return (int)count;
+}
+
+int HP_GetAllEntries(HP_info* hp_info, int value){
+    /* The scan lives on the stack, a lookup does not allocate memory */
+    Record_Predicate predicate = { ID, EQUAL, value, NULL };
+    HP_Scan scan;
+    scan_init(&scan, hp_info, &predicate);
+
+    const Record *record = HP_ScanNext(&scan);
+    if (record == NULL){
+        return -1;
+    }
+    printRecord(*record);
+
+    /* The number of blocks before the one with the record */
+    int block_counter = scan.block_num - 1;
+    if (scan_release(&scan) == -1){
+        return -1;
+    }
+    return block_counter;
 }
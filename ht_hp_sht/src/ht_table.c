@@ -1,3 +1,4 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,9 +7,11 @@
 #include "ht_table.h"
 #include "record.h"
 
-#define NEXT_BUCKET BB_BLOCK_SIZE-sizeof(int)
-#define NEXT    BF_BLOCK_SIZE-sizeof(HT_block_info)
-#define MAX_REC (BF_BLOCK_SIZE-sizeof(HT_block_info))/sizeof(Record)
+#define NEXT_BUCKET (BF_GetBlockSize()-sizeof(int))
+#define NEXT    (BF_GetBlockSize()-sizeof(HT_block_info))
+#define MAX_REC ((BF_GetBlockSize()-sizeof(HT_block_info))/sizeof(Record))
+#define PREFETCH_BLOCKS 16
+#define DIR_ENTRIES (BF_GetBlockSize()/sizeof(HT_table))   /* directory entries per block */
 
 #define CALL_OR_DIE(call)     \
   {                           \
@@ -20,7 +23,134 @@
   }
 
 
-int HT_CreateFile(char *fileName,  int buckets) {
+/* The directory of the buckets is a run of dirBlocks blocks from dirFirst,
+   the entry of a bucket is found from its number alone. An open file keeps
+   it in memory, and the blocks of the entries that changed are written back
+   by dir_flush */
+static int dir_get(const HT_info *ht_info, int bucket, HT_table *entry){
+    *entry = ht_info->directory[bucket];
+    return 0;
+}
+
+static int dir_set(HT_info *ht_info, int bucket, const HT_table *entry){
+    ht_info->directory[bucket] = *entry;
+    ht_info->dirDirty[bucket / DIR_ENTRIES] = 1;
+    return 0;
+}
+
+/* Read the directory of the file into memory */
+static int dir_load(HT_info *ht_info){
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    ht_info->directory = malloc(ht_info->dirBlocks * DIR_ENTRIES * sizeof(HT_table));
+    ht_info->dirDirty = calloc(ht_info->dirBlocks, 1);
+    if (ht_info->directory == NULL || ht_info->dirDirty == NULL){
+        return -1;
+    }
+    for (int b = 0; b < ht_info->dirBlocks; b++){
+        if (BF_GetBlock(ht_info->fileDesc, ht_info->dirFirst + b, block) != BF_OK){
+            return -1;
+        }
+        memcpy(ht_info->directory + b * DIR_ENTRIES, BF_Block_GetData(block), DIR_ENTRIES * sizeof(HT_table));
+        if (BF_UnpinBlock(block) != BF_OK){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Write the directory blocks that changed since the last flush */
+static int dir_flush(HT_info *ht_info){
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    for (int b = 0; b < ht_info->dirBlocks; b++){
+        if (!ht_info->dirDirty[b]){
+            continue;
+        }
+        if (BF_GetBlock(ht_info->fileDesc, ht_info->dirFirst + b, block) != BF_OK){
+            return -1;
+        }
+        memcpy(BF_Block_GetData(block), ht_info->directory + b * DIR_ENTRIES, DIR_ENTRIES * sizeof(HT_table));
+        BF_Block_SetDirty(block);
+        if (BF_UnpinBlock(block) != BF_OK){
+            return -1;
+        }
+        ht_info->dirDirty[b] = 0;
+    }
+    return 0;
+}
+
+static void dir_free(HT_info *ht_info){
+    free(ht_info->directory);
+    free(ht_info->dirDirty);
+    ht_info->directory = NULL;
+    ht_info->dirDirty = NULL;
+}
+
+/* The blocks a split or a move of the directory gave up form a list
+   through HT_block_info.next from freeBlock, and new chain blocks come
+   from it before the end of the file */
+static int free_block(HT_info *ht_info, int block_id){
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    if (BF_GetBlock(ht_info->fileDesc, block_id, block) != BF_OK){
+        return -1;
+    }
+    HT_block_info *block_info = (void *)BF_Block_GetData(block) + NEXT;
+    block_info->recordsCounter = 0;
+    block_info->next = ht_info->freeBlock;
+    BF_Block_SetDirty(block);
+    if (BF_UnpinBlock(block) != BF_OK){
+        return -1;
+    }
+    ht_info->freeBlock = block_id;
+    ht_info->freeBlocks++;
+    return 0;
+}
+
+/* Move the directory to blocks new blocks at the end of the file. The new
+   entries are empty and every block is written by the next flush. The old
+   run becomes free blocks for the chains, but only after the new run and
+   the header that points to it have been written, so the header never
+   points to a run that free_block has written over */
+static int dir_allocate(HT_info *ht_info, int blocks){
+    int first;
+    if (BF_AllocateBlocks(ht_info->fileDesc, blocks, &first, NULL) != BF_OK){
+        return -1;
+    }
+    int old_first = ht_info->dirFirst;
+    int old_blocks = ht_info->dirBlocks;
+    HT_table *directory = realloc(ht_info->directory, blocks * DIR_ENTRIES * sizeof(HT_table));
+    unsigned char *dirty = realloc(ht_info->dirDirty, blocks);
+    if (directory != NULL){
+        ht_info->directory = directory;
+    }
+    if (dirty != NULL){
+        ht_info->dirDirty = dirty;
+    }
+    if (directory == NULL || dirty == NULL){
+        return -1;
+    }
+    for (int i = ht_info->dirBlocks * DIR_ENTRIES; i < blocks * DIR_ENTRIES; i++){
+        directory[i].first = -1;
+        directory[i].last = -1;
+    }
+    memset(dirty, 1, blocks);
+    ht_info->dirFirst = first;
+    ht_info->dirBlocks = blocks;
+    if (old_blocks > 0 && HT_Checkpoint(ht_info) == -1){
+        return -1;
+    }
+    for (int b = 0; b < old_blocks; b++){
+        if (free_block(ht_info, old_first + b) == -1){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Create the file of either mode, every bucket starts empty */
+static int create_file(char *fileName, int buckets, HT_Mode mode, HT_Hash function) {
 
     /* Create a file with name filename */ 
     if (BF_CreateFile(fileName) == BF_ERROR) {
@@ -35,17 +165,13 @@ int HT_CreateFile(char *fileName,  int buckets) {
     }
     
 
-    /* Allocate the header block that keeps the HP_info */
+    /* Allocate the header block that keeps the HP_info, it comes back pinned */
     BF_Block *block;
     BF_Block_Init(&block);
     if (BF_AllocateBlock(fileDesc, block) == BF_ERROR){
         return -1;
     }
 
-    if (BF_GetBlock(fileDesc, 0, block) == BF_ERROR){
-        return -1;
-    }
-
 
     /* Read the header block and take the address */
     void *data = BF_Block_GetData(block);
@@ -55,15 +181,27 @@ int HT_CreateFile(char *fileName,  int buckets) {
     ht_info->fileDesc = fileDesc;
     ht_info->first_block = block;
     ht_info->numBuckets = buckets;
-   
-
-    void* data_table = data + sizeof(HT_info);
-    HT_table * table = data_table;
-    for(int i=0; i<buckets; i++) {
-        table = data_table + i*sizeof(HT_table);
-        /* Pointing that at first place our bucket is empty */
-        table->first = -1;
-        table->last = -1;
+    ht_info->mode = mode;
+    ht_info->initialBuckets = buckets;
+    ht_info->level = 0;
+    ht_info->split = 0;
+    ht_info->splits = 0;
+    ht_info->records = 0;
+    ht_info->hashFunction = function;
+    ht_info->freeBlock = -1;
+    ht_info->freeBlocks = 0;
+
+    /* The directory follows the header, as many blocks as the buckets need */
+    ht_info->dirBlocks = 0;
+    ht_info->directory = NULL;
+    ht_info->dirDirty = NULL;
+    int code = dir_allocate(ht_info, (buckets + DIR_ENTRIES - 1) / DIR_ENTRIES);
+    if (code == 0){
+        code = dir_flush(ht_info);
+    }
+    dir_free(ht_info);
+    if (code == -1){
+        return -1;
     }
 
     /* Store ht_block_info at the end of first block */
@@ -81,30 +219,50 @@ int HT_CreateFile(char *fileName,  int buckets) {
     }
       
     BF_Block_Destroy(&block);
-    BF_CloseFile(fileDesc);
+    if (BF_CloseFile(fileDesc) != BF_OK) {
+        return -1;
+    }
 
     return 0;
 }
 
+int HT_CreateFile(char *fileName,  int buckets) {
+    return HT_CreateFileHash(fileName, buckets, HT_MODE_STATIC, HT_HASH_MODULO);
+}
+
+int HT_CreateFileLinear(char *fileName, int buckets) {
+    return HT_CreateFileHash(fileName, buckets, HT_MODE_LINEAR, HT_HASH_MODULO);
+}
+
+int HT_CreateFileHash(char *fileName, int buckets, HT_Mode mode, HT_Hash function) {
+    if (buckets < 1 || mode < HT_MODE_STATIC || mode > HT_MODE_LINEAR
+        || function < HT_HASH_MODULO || function > HT_HASH_WYHASH) {
+        return -1;
+    }
+    return create_file(fileName, buckets, mode, function);
+}
+
 
 HT_info* HT_OpenFile(char *fileName){
+    return HT_OpenFileMode(fileName, BF_OPEN_BUFFERED);
+}
+
 
-    /* Get the file identifier with BF_OpenFile */
+HT_info* HT_OpenFileMode(char *fileName, BF_OpenMode mode){
+
+    /* Get the file identifier with BF_OpenFileMode */
     int fileDesc;
-    if (BF_OpenFile(fileName, &fileDesc)== BF_ERROR) {
+    if (BF_OpenFileMode(fileName, &fileDesc, mode) != BF_OK) {
         return NULL;
     }
    
 
-    /*Read the header_block*/
+    /*Read the header_block, it stays pinned until HT_CloseFile*/
     BF_Block *block;
     BF_Block_Init(&block);
-    if (BF_AllocateBlock(fileDesc, block) == BF_ERROR){
-        return NULL;
-    }
-    
-
-    if (BF_GetBlock(fileDesc,0, block) == BF_ERROR){
+    if (BF_GetBlock(fileDesc,0, block) != BF_OK){
+        BF_Block_Destroy(&block);
+        BF_CloseFile(fileDesc);
         return NULL;
     }
 
@@ -116,13 +274,44 @@ HT_info* HT_OpenFile(char *fileName){
     
     memcpy(info, header_info, sizeof(HT_info));
 
+    /* The descriptor and the handle stored in the header belong to the run that created the file */
+    info->fileDesc = fileDesc;
+    info->first_block = block;
+
+    /* The directory is read once, the operations use the copy in memory */
+    if (dir_load(info) == -1){
+        dir_free(info);
+        BF_UnpinBlock(block);
+        BF_Block_Destroy(&block);
+        BF_CloseFile(fileDesc);
+        free(info);
+        return NULL;
+    }
 
     return info ;  
 }
 
 
+int HT_Checkpoint(HT_info* ht_info){
+
+    /* The header block is pinned, the header goes back with the fields that changed */
+    memcpy(BF_Block_GetData(ht_info->first_block), ht_info, sizeof(HT_info));
+    BF_Block_SetDirty(ht_info->first_block);
+    return dir_flush(ht_info);
+}
+
+
 int HT_CloseFile( HT_info* HT_info ){
-   
+
+    if (HT_Checkpoint(HT_info) == -1){
+        return -1;
+    }
+    dir_free(HT_info);
+
+    /* The header block was pinned by HT_OpenFile, the file does not close with a pinned block */
+    if (BF_UnpinBlock(HT_info->first_block) == BF_ERROR){
+        return -1;
+    }
     BF_Block_Destroy(&HT_info->first_block);
     if (BF_CloseFile(HT_info->fileDesc)== BF_ERROR){
         BF_PrintError(BF_CloseFile(HT_info->fileDesc));
@@ -132,45 +321,283 @@ int HT_CloseFile( HT_info* HT_info ){
     return 0;
 }
 
-int hash(long int nbuckets, int key){
-    return key%nbuckets;
+static const char *hash_names[] = {"modulo", "fibonacci", "wyhash"};
+
+/* The 64x64 to 128 bit multiply of wyhash, folded back to 64 bits */
+static uint64_t wymix(uint64_t a, uint64_t b){
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+/* The 32-bit value of the id under the hash function of the file. Every
+   mode takes it modulo its number of buckets, so the value has to be mixed
+   in its low bits too */
+static unsigned int hash_value(int function, int key){
+    switch (function){
+    case HT_HASH_FIBONACCI:
+        /* The upper half of the product by 2^64/phi depends on every bit of the key */
+        return (uint64_t)(uint32_t)key * 0x9E3779B97F4A7C15ull >> 32;
+    case HT_HASH_WYHASH:
+        return wymix((uint32_t)key ^ 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull);
+    default:
+        return (unsigned int)key;
+    }
+}
+
+/* The bucket of the key in a static file */
+static int static_bucket(const HT_info *ht_info, int key){
+    return hash_value(ht_info->hashFunction, key) % (unsigned int)ht_info->numBuckets;
+}
+
+/* The bucket of the key in a linear file: the buckets before the split
+   pointer were split in this round and use one more bit of the key */
+static int linear_bucket(const HT_info *ht_info, int key){
+    unsigned int value = hash_value(ht_info->hashFunction, key);
+    unsigned int buckets = ht_info->initialBuckets << ht_info->level;
+    unsigned int bucket = value % buckets;
+    if (bucket < ht_info->split){
+        bucket = value % (2 * buckets);
+    }
+    return bucket;
+}
+
+/* How far the records per bucket are from what the hash function should
+   give. chi_square is against the expected count of every bucket, so
+   dividing by buckets - 1 gives about 1 for a function that spreads the
+   keys like a random one */
+static void print_skew(int function, int buckets, long records, double chi_square, int max){
+    printf("hash function: %s\n", hash_names[function]);
+    if (records == 0 || buckets < 2){
+        return;
+    }
+    printf("chi-square %.1f over %d buckets, %.2f per degree of freedom\n",
+           chi_square, buckets, chi_square / (buckets - 1));
+    printf("max/mean records per bucket %.2f\n", max / ((double)records / buckets));
+}
+
+/* Add the record at the end of the chain of entry. A full last block gets a
+   new one after it, from the free blocks when there are any or else from
+   the end of the file. Returns the block of the record */
+static int chain_append(HT_info *ht_info, HT_table *entry, const Record *record){
+    BF_BlockStorage prev_storage;
+    BF_Block *prev = NULL;
+
+    if (entry->last != -1){
+        prev = BF_Block_InitIn(&prev_storage);
+        if (BF_GetBlock(ht_info->fileDesc, entry->last, prev) != BF_OK){
+            return -1;
+        }
+        void *data = BF_Block_GetData(prev);
+        HT_block_info *block_info = data + NEXT;
+        if (block_info->recordsCounter < MAX_REC){
+            memcpy(data + sizeof(Record)*block_info->recordsCounter, record, sizeof(Record));
+            block_info->recordsCounter++;
+            BF_Block_SetDirty(prev);
+            if (BF_UnpinBlock(prev) != BF_OK){
+                return -1;
+            }
+            return entry->last;
+        }
+        /* The full block stays pinned until it points to the new one */
+    }
+
+    BF_Block *block = BF_Block_InitIn(&ht_info->handle);
+    int block_id;
+    if (ht_info->freeBlock != -1){
+        block_id = ht_info->freeBlock;
+        if (BF_GetBlock(ht_info->fileDesc, block_id, block) != BF_OK){
+            if (prev != NULL){
+                BF_UnpinBlock(prev);
+            }
+            return -1;
+        }
+        ht_info->freeBlock = ((HT_block_info *)((void *)BF_Block_GetData(block) + NEXT))->next;
+        ht_info->freeBlocks--;
+    } else if (BF_AllocateBlocks(ht_info->fileDesc, 1, &block_id, &block) != BF_OK){
+        if (prev != NULL){
+            BF_UnpinBlock(prev);
+        }
+        return -1;
+    }
+    void *data = BF_Block_GetData(block);
+    HT_block_info *block_info = data + NEXT;
+    memcpy(data, record, sizeof(Record));
+    block_info->recordsCounter = 1;
+    block_info->next = -1;
+    BF_Block_SetDirty(block);
+    if (BF_UnpinBlock(block) != BF_OK){
+        if (prev != NULL){
+            BF_UnpinBlock(prev);
+        }
+        return -1;
+    }
+
+    if (prev != NULL){
+        HT_block_info *prev_info = (void *)BF_Block_GetData(prev) + NEXT;
+        prev_info->next = block_id;
+        BF_Block_SetDirty(prev);
+        if (BF_UnpinBlock(prev) != BF_OK){
+            return -1;
+        }
+    } else {
+        entry->first = block_id;
+    }
+    entry->last = block_id;
+    return block_id;
+}
+
+/* Split the bucket of the split pointer into itself and a new bucket at the
+   end of the table, and move the pointer on. Only the chain of that bucket
+   is read. Its records are written to two new chains first, and its blocks
+   are given up only once the directory points to those, so a split that
+   fails leaves the bucket as it was */
+static int linear_split(HT_info *ht_info){
+    unsigned int round = ht_info->initialBuckets << ht_info->level;
+    int old_bucket = ht_info->split;
+    int new_bucket = ht_info->numBuckets;
+
+    /* A full directory moves to a run twice as long */
+    if (new_bucket == ht_info->dirBlocks * DIR_ENTRIES
+        && dir_allocate(ht_info, 2 * ht_info->dirBlocks) == -1){
+        return -1;
+    }
+
+    HT_table old_chain;
+    if (dir_get(ht_info, old_bucket, &old_chain) == -1){
+        return -1;
+    }
+
+    /* Take the records and the blocks of the chain */
+    Record *records = NULL;
+    int count = 0;
+    int *blocks = NULL;
+    int block_count = 0;
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    int code = 0;
+    for (int b = old_chain.first; b != -1 && code == 0; ){
+        if (BF_GetBlock(ht_info->fileDesc, b, block) != BF_OK){
+            code = -1;
+            break;
+        }
+        void *data = BF_Block_GetData(block);
+        HT_block_info *block_info = data + NEXT;
+        Record *more = realloc(records, (count + block_info->recordsCounter) * sizeof(Record));
+        int *more_blocks = realloc(blocks, (block_count + 1) * sizeof(int));
+        if (more != NULL){
+            records = more;
+        }
+        if (more_blocks != NULL){
+            blocks = more_blocks;
+        }
+        if (more == NULL || more_blocks == NULL){
+            code = -1;
+        } else {
+            memcpy(records + count, data, block_info->recordsCounter * sizeof(Record));
+            count += block_info->recordsCounter;
+            blocks[block_count++] = b;
+        }
+        int next = block_info->next;
+        if (BF_UnpinBlock(block) != BF_OK){
+            code = -1;
+        }
+        b = next;
+    }
+
+    /* Deal them again with one more bit of the key, into new chains */
+    HT_table old_entry = { -1, -1 };
+    HT_table new_entry = { -1, -1 };
+    for (int i = 0; i < count && code == 0; i++){
+        HT_table *entry = hash_value(ht_info->hashFunction, records[i].id) % (2 * round) == old_bucket
+            ? &old_entry : &new_entry;
+        if (chain_append(ht_info, entry, &records[i]) == -1){
+            code = -1;
+        }
+    }
+    free(records);
+    if (code == -1 || dir_set(ht_info, old_bucket, &old_entry) == -1
+        || dir_set(ht_info, new_bucket, &new_entry) == -1){
+        free(blocks);
+        return -1;
+    }
+
+    ht_info->numBuckets++;
+    ht_info->splits++;
+    ht_info->split++;
+    if (ht_info->split == round){
+        ht_info->level++;
+        ht_info->split = 0;
+    }
+
+    /* The old chain is not reachable any more, the next chains reuse it */
+    for (int i = 0; i < block_count && code == 0; i++){
+        code = free_block(ht_info, blocks[i]);
+    }
+    free(blocks);
+    return code;
+}
+
+/* Insert into a linear file, and split one bucket when the load passed
+   HT_LINEAR_LOAD. The split moves the directory to a run twice as long
+   when the new bucket does not fit in the current one */
+static int linear_insert(HT_info *ht_info, Record record){
+    int bucket = linear_bucket(ht_info, record.id);
+    HT_table entry;
+    if (dir_get(ht_info, bucket, &entry) == -1){
+        return -1;
+    }
+    int last = entry.last;
+    int block_id = chain_append(ht_info, &entry, &record);
+    if (block_id == -1 || (entry.last != last && dir_set(ht_info, bucket, &entry) == -1)){
+        return -1;
+    }
+    ht_info->records++;
+
+    if ((long)ht_info->records * 100 > (long)HT_LINEAR_LOAD * ht_info->numBuckets * MAX_REC){
+        if (linear_split(ht_info) == -1){
+            return -1;
+        }
+        /* The record may have moved to the new bucket */
+        if (dir_get(ht_info, linear_bucket(ht_info, record.id), &entry) == -1){
+            return -1;
+        }
+        block_id = entry.last;
+    }
+    return block_id;
 }
 
 int HT_InsertEntry(HT_info* ht_info, Record record){
+    if (ht_info->mode == HT_MODE_LINEAR) {
+        return linear_insert(ht_info, record);
+    }
     
     /* The returning value initialize as -1 in case the record does not entry */
     int block_counter=-1;
 
     /* Make the hash value */
-    int index = hash(ht_info->numBuckets, record.id);
+    int index = static_bucket(ht_info, record.id);
 
-    /* Get the first block that contains the hash table */
-    BF_Block *first_block;
-    BF_Block_Init(&first_block);
-    if (BF_GetBlock(ht_info->fileDesc, 0, first_block) == BF_ERROR){
+    /* The handle lives in ht_info, an insert does not allocate memory */
+    BF_Block *block = BF_Block_InitIn(&ht_info->handle);
+
+    /* Read the entry of the bucket from the directory */
+    HT_table table_entry;
+    HT_table *table_index = &table_entry;
+    if (dir_get(ht_info, index, table_index) == -1){
         return -1;
     }
 
-
-    void *data = BF_Block_GetData(first_block);
-    void* data_table = data + sizeof(HT_info) + index*sizeof(HT_table);
-
-    /* Go to the memory space that hash table is saved */
-    HT_table *table_index = data_table;
-
     /* This variable is in order to check if we have insert the element in the last block or not */
     int full_or_first=0;
 
     /* Check if this index has  any block */
     if (table_index->last != -1) {
         /* So if it does we go in the last one and check if there is any space to insert our record */
-        BF_Block *last_block;
-        BF_Block_Init(&last_block);
-        if (BF_GetBlock(ht_info->fileDesc, table_index->last , last_block) == BF_ERROR){
+        if (BF_GetBlock(ht_info->fileDesc, table_index->last , block) != BF_OK){
             return -1;
         }
 
-        void *data = BF_Block_GetData(last_block);
+        void *data = BF_Block_GetData(block);
         HT_block_info *last_block_info = data+ NEXT;
     
     
@@ -179,58 +606,67 @@ int HT_InsertEntry(HT_info* ht_info, Record record){
 
             /* Insert the record inside last block, enough space */
             memcpy(data+sizeof(Record)*(last_block_info->recordsCounter), &record, sizeof(Record));
-            Record *rec = data+sizeof(Record)*(last_block_info->recordsCounter) ;
             full_or_first=1;
           
             last_block_info->recordsCounter++;
             block_counter= table_index->last;
             
-            BF_Block_SetDirty(last_block);
-            if (BF_UnpinBlock(last_block)== BF_ERROR){
-                return -1;
-            }
+            BF_Block_SetDirty(block);
+        }
+        if (BF_UnpinBlock(block) != BF_OK){
+            return -1;
         }
     }
     
     if(full_or_first==0){
         /* Create a new block and insert this first record */
-        BF_Block *new_block;
-        BF_Block_Init(&new_block);
-        if (BF_AllocateBlock(ht_info->fileDesc, new_block) == BF_ERROR){
-            return -1;
-        }
-
         /* Change the pointer of the last block */
+        /* The data blocks start after the header and the directory */
+        int data_first = ht_info->dirFirst + ht_info->dirBlocks;
         if (table_index->last == -1) {
             /* In oder to avoid having the same block in different indexes */
-            /* Index+1 while block0 is the header block */
-            table_index->last = index + 1;
-            table_index->first = index + 1;
+            table_index->last = data_first + index;
+            table_index->first = data_first + index;
         }
         else {
             /* It depends on the num of buckets to which will be the next block */
             table_index->last += ht_info->numBuckets ;
         }
+        if (dir_set(ht_info, index, table_index) == -1){
+            return -1;
+        }
 
+        /* The block of the bucket may lie past the end of the file. The whole
+           overflow level it belongs to is allocated as one extent, so the next
+           overflow blocks of the other buckets are already in place */
+        int blocks_num;
+        if (BF_GetBlockCounter(ht_info->fileDesc, &blocks_num) != BF_OK){
+            return -1;
+        }
+        if (blocks_num <= table_index->last) {
+            int level_end = data_first + ((table_index->last - data_first) / ht_info->numBuckets + 1) * ht_info->numBuckets;
+            if (BF_AllocateBlocks(ht_info->fileDesc, level_end - blocks_num, NULL, NULL) != BF_OK){
+                return -1;
+            }
+        }
 
-        if (BF_GetBlock(ht_info->fileDesc, table_index->last, new_block) == BF_ERROR){
+        if (BF_GetBlock(ht_info->fileDesc, table_index->last, block) != BF_OK){
             return -1;
         }
 
         /* Create block info for my new block */
-        data = BF_Block_GetData(new_block);
+        void *data = BF_Block_GetData(block);
         HT_block_info *new_block_info = data+ NEXT;
         new_block_info->recordsCounter=0;
 
         /* Insert the record in the block */
         memcpy(data+sizeof(Record)*(new_block_info->recordsCounter), &record, sizeof(Record));
         new_block_info->recordsCounter++;
-        Record *rec = data+sizeof(Record)*(new_block_info->recordsCounter);
         
 
         /* Because we changed the (initially empty) data of the first block */
-        BF_Block_SetDirty(new_block); 
-        if (BF_UnpinBlock(new_block)== BF_ERROR){
+        BF_Block_SetDirty(block); 
+        if (BF_UnpinBlock(block) != BF_OK){
             return -1;
         }
     }
@@ -239,37 +675,92 @@ int HT_InsertEntry(HT_info* ht_info, Record record){
     return block_counter;
 }
 
+/* Lookup in a linear file: the chain of the bucket is followed through next */
+static int linear_get(HT_info *ht_info, int value){
+    HT_table entry;
+    if (dir_get(ht_info, linear_bucket(ht_info, value), &entry) == -1){
+        return -1;
+    }
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    int count = 0;
+
+    for (int blockID = entry.first; blockID != -1; ){
+        count++;
+        if (BF_GetBlock(ht_info->fileDesc, blockID, block) != BF_OK){
+            return -1;
+        }
+        void *data = BF_Block_GetData(block);
+        HT_block_info *block_info = data + NEXT;
+        int found = 0;
+        for (int j = 0; j < block_info->recordsCounter; j++){
+            Record *current_rec = data + j*sizeof(Record);
+            if (current_rec->id == value){
+                printRecord(*current_rec);
+                found = 1;
+                break;
+            }
+        }
+        blockID = block_info->next;
+        if (BF_UnpinBlock(block) != BF_OK){
+            return -1;
+        }
+        if (found){
+            return count;
+        }
+    }
+    return -1;
+}
+
 int HT_GetAllEntries(HT_info* ht_info, void *value ){
+    if (ht_info->mode == HT_MODE_LINEAR) {
+        return linear_get(ht_info, *(int*)value);
+    }
   
     /* Get from the hash function the right pos our index in order to find the right id */
     int new_value= *(int*)value;
-    int index = hash(ht_info->numBuckets, new_value);
+    int index = static_bucket(ht_info, new_value);
  
     int count = 0;
     int blockID = 0;
     /* In case the id does not exist */
     int block_counter = -1;
     
-    /* Get the block ID of first block of records */
-    BF_Block *current_block ;
-    BF_Block_Init(&current_block);
-    if (BF_GetBlock(ht_info->fileDesc, 0, current_block) == BF_ERROR){
+    /* Get the block ID of first block of records from the directory */
+    HT_table table_index;
+    if (dir_get(ht_info, index, &table_index) == -1){
         return -1;
     }
+    blockID = table_index.first;
+    int last = table_index.last;
 
-    /* Go to the part of block that is stored our hash table */
-    void *data = BF_Block_GetData(current_block);
-    void* data_table = data + sizeof(HT_info) + index*sizeof(HT_table);
-    HT_table *table_index = data_table;
+    /* A bucket that never got a record has no blocks */
+    if (blockID == -1){
+        return -1;
+    }
+
+    /* The handle lives on the stack */
+    BF_BlockStorage current_storage;
+    BF_Block *current_block = BF_Block_InitIn(&current_storage);
     HT_block_info *current_block_info;
-    blockID = table_index->first;
+    void *data;
    
     /* Go through the blocks of our hash index position */
-    while(blockID <=table_index->last) {
+    while(blockID <= last) {
         /* Count the number of blocks */
         count++;
 
-        if (BF_GetBlock(ht_info->fileDesc, blockID, current_block) == BF_ERROR){
+        /* The rest of the chain is known, ask for it before we need it */
+        if ((count - 1) % PREFETCH_BLOCKS == 0){
+            int prefetch[PREFETCH_BLOCKS];
+            int n = 0;
+            for (int b = blockID; b <= last && n < PREFETCH_BLOCKS; b += ht_info->numBuckets){
+                prefetch[n++] = b;
+            }
+            BF_Prefetch(ht_info->fileDesc, prefetch, n);
+        }
+
+        if (BF_GetBlock(ht_info->fileDesc, blockID, current_block) != BF_OK){
             return -1;
         }
         
@@ -286,6 +777,10 @@ int HT_GetAllEntries(HT_info* ht_info, void *value ){
             }
         }
 
+        if (BF_UnpinBlock(current_block) != BF_OK){
+            return -1;
+        }
+
         /* If we found the id stop while */
         if( block_counter==blockID){
             break;
@@ -294,78 +789,122 @@ int HT_GetAllEntries(HT_info* ht_info, void *value ){
         /* Go to the next block if this index */
         blockID += ht_info->numBuckets ;
     }
-    
-    BF_Block_SetDirty(current_block); 
-    if (BF_UnpinBlock(current_block)== BF_ERROR){
-        return -1;
-    }
 
     return block_counter;
 }
 
-int HashStatistics(char* fileName){
-
-	/* Open the file with name filename */
-    int fileDesc;
-    if (BF_OpenFile(fileName, &fileDesc) == BF_ERROR) {
-        return -1;
-    }
-
-
-	/* Allocate the header block that keeps the HP_info */
-    BF_Block *first_block;
-    BF_Block_Init(&first_block);
-    if (BF_AllocateBlock(fileDesc, first_block) == BF_ERROR){
-        return -1;
-    }
-
-
-	if (BF_GetBlock(fileDesc, 0, first_block) == BF_ERROR){
-        return -1;
+/* The statistics of a linear file, whose chains are followed through next */
+static int linear_statistics(const HT_info *ht_info){
+    int fileDesc = ht_info->fileDesc;
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    int blockSum = 1 + ht_info->dirBlocks + ht_info->freeBlocks;
+    int overflow = 0;
+    int max = 0;
+    int min = -1;
+    long rec_sum = 0;
+
+    /* The buckets on either side of this round's split hold half the keys
+       of the others, squares sums count^2/weight so that the chi-square
+       is against those shares */
+    unsigned int round = ht_info->initialBuckets << ht_info->level;
+    double squares = 0;
+
+    for (int i = 0; i < ht_info->numBuckets; i++){
+        int records = 0;
+        int blocks = 0;
+        HT_table table;
+        if (dir_get(ht_info, i, &table) == -1){
+            return -1;
+        }
+        for (int b = table.first; b != -1; blocks++){
+            if (BF_GetBlock(fileDesc, b, block) != BF_OK){
+                return -1;
+            }
+            HT_block_info *block_info = (void *)BF_Block_GetData(block) + NEXT;
+            records += block_info->recordsCounter;
+            b = block_info->next;
+            if (BF_UnpinBlock(block) != BF_OK){
+                return -1;
+            }
+        }
+        blockSum += blocks;
+        if (blocks > 1){
+            overflow += blocks - 1;
+        }
+        if (min == -1 || records < min){
+            min = records;
+        }
+        if (records > max){
+            max = records;
+        }
+        rec_sum += records;
+        double weight = (i < ht_info->split || i >= round) ? 0.5 : 1.0;
+        squares += (double)records * records / weight;
     }
 
+    printf("-----------------------------------------------------------------\n");
+    printf("                   Linear Hash Table Statistics                   \n");
+    printf("the number of blocks in this file is : %d\n", blockSum);
+    printf("buckets: %d, created with %d\n", ht_info->numBuckets, ht_info->initialBuckets);
+    printf("level %d, split pointer %d, %d splits\n", ht_info->level, ht_info->split, ht_info->splits);
+    printf("load factor %.2f (splits above %.2f)\n",
+           (double)rec_sum / ((double)ht_info->numBuckets * MAX_REC), HT_LINEAR_LOAD / 100.0);
+    printf("max record sum = %d\n", max);
+    printf("min record sum = %d\n", min);
+    printf("avg record sum = %.1f\n", (double)rec_sum / ht_info->numBuckets);
+    printf("%d overflow blocks, %d free blocks\n", overflow, ht_info->freeBlocks);
+    print_skew(ht_info->hashFunction, ht_info->numBuckets, rec_sum,
+               rec_sum == 0 ? 0 : round * squares / rec_sum - rec_sum, max);
+    printf("-----------------------------------------------------------------\n");
+    return 0;
+}
 
-	/* Read the header block and take the address */
-    void *data = BF_Block_GetData(first_block);
-
-
-    /* Store ht_info at the beginning of first block */ 
-    HT_info *ht_info = data;
-    
-
-    void* index = data + sizeof(HT_info);
-    HT_table * table = index;
-    int  blockSum = 1;
+/* The statistics of a static file, whose chains are every numBuckets blocks */
+static int static_statistics(const HT_info *ht_info){
+    int fileDesc = ht_info->fileDesc;
+    HT_table table_entry;
+    HT_table * table = &table_entry;
+    int  blockSum = 1 + ht_info->dirBlocks;
 
-    BF_Block *current_block ;
-    BF_Block_Init(&current_block);
+    /* The handle lives on the stack */
+    BF_BlockStorage current_storage;
+    BF_Block *current_block = BF_Block_InitIn(&current_storage);
     HT_block_info *current_block_info;
     int* rec_count = malloc(ht_info->numBuckets*sizeof(int));
+    int* overflow = malloc(ht_info->numBuckets*sizeof(int));
+    if (rec_count == NULL || overflow == NULL){
+        free(rec_count);
+        free(overflow);
+        return -1;
+    }
 
     int max = 0;
     int min = 10000;
-    double avg;
     int rec_sum = 0;
 
     int block_overflow=0;
-    int* overflow = malloc(ht_info->numBuckets*sizeof(int));
     for(int i=0; i< ht_info->numBuckets; i++) {
-        
-        table = index + i*sizeof(HT_table);
+
+        if (dir_get(ht_info, i, table) == -1){
+            free(rec_count);
+            free(overflow);
+            return -1;
+        }
         int first = table->first;
         int last = table->last;
-        
+
         overflow[i] = 0;
 
         if(first != -1){
-            
+
             if(first == last){
                 blockSum ++;
 
                 rec_count[i] = 0;
             }
             else{
-        
+
                 int bucket_blocks = (last-first)/ht_info->numBuckets+1;
                 blockSum += bucket_blocks;
 
@@ -375,13 +914,19 @@ int HashStatistics(char* fileName){
                 overflow[i] = bucket_blocks-1;
             }
 
-            if (BF_GetBlock(ht_info->fileDesc, last, current_block) == BF_ERROR){
+            /* Only the last block of the chain is not full */
+            if (BF_GetBlock(fileDesc, last, current_block) != BF_OK){
+                free(rec_count);
+                free(overflow);
                 return -1;
             }
-
-            data = BF_Block_GetData(current_block);
-            current_block_info = data + NEXT ;
+            current_block_info = (void *)BF_Block_GetData(current_block) + NEXT;
             rec_count[i] += current_block_info->recordsCounter;
+            if (BF_UnpinBlock(current_block) != BF_OK){
+                free(rec_count);
+                free(overflow);
+                return -1;
+            }
         }
         else{
             rec_count[i] = 0;
@@ -389,18 +934,18 @@ int HashStatistics(char* fileName){
 
         if(rec_count[i] < min){
             min = rec_count[i];
-        }  
-        
+        }
+
         if(rec_count[i] > max){
             max = rec_count[i];
-        }        
-        
-        rec_sum += rec_count[i]; 
+        }
+
+        rec_sum += rec_count[i];
     }
     printf("-----------------------------------------------------------------\n");
     printf("                        Hash Table Statistics                      \n");
     printf("                \n");
-    printf("MAX REC %ld",MAX_REC);
+    printf("MAX REC %ld\n",MAX_REC);
     printf("the number of blocks in this file is : %d\n",blockSum);
     printf("the average number of blocks in every bucket : %d\n",blockSum/ht_info->numBuckets);
     printf("max record sum = %d\n", max);
@@ -408,20 +953,66 @@ int HashStatistics(char* fileName){
     printf("avg record sum = %d\n", rec_sum/ht_info->numBuckets);
     printf("%d blocks overflow\n",block_overflow);
 
+    /* Against rec_sum/numBuckets records in every bucket */
+    double squares = 0;
+    for(int i=0; i< ht_info->numBuckets; i++){
+        squares += (double)rec_count[i] * rec_count[i];
+    }
+    print_skew(ht_info->hashFunction, ht_info->numBuckets, rec_sum,
+               rec_sum == 0 ? 0 : ht_info->numBuckets * squares / rec_sum - rec_sum, max);
+
     for(int i=0; i< ht_info->numBuckets; i++){
         printf("bucket[%d] has %d overflow blocks\n", i, overflow[i]);
     }
 
+    /* What the file has cost the buffer pool so far */
+    BF_Stats stats;
+    if (BF_GetStats(fileDesc, &stats) == BF_OK) {
+        printf("buffer pool: %ld gets, %ld hits, %ld reads, %ld evictions, %ld dirty writes, %ld pinned\n",
+               stats.gets, stats.hits, stats.reads, stats.evictions, stats.writes, stats.pins);
+        printf("buffer pool: %ld bytes read, %ld bytes written\n", stats.bytes_read, stats.bytes_written);
+    }
+
     printf("-----------------------------------------------------------------\n");
-    
+    free(rec_count);
+    free(overflow);
+    return 0;
+}
 
-    /* Because we changed the (initially empty) data of the first block */
-    BF_Block_SetDirty(first_block); 
-	if (BF_UnpinBlock(first_block)== BF_ERROR) {
-		return -1;
+int HashStatistics(char* fileName){
+
+	/* Open the file with name filename */
+    int fileDesc;
+    if (BF_OpenFile(fileName, &fileDesc) != BF_OK) {
+        return -1;
+    }
+
+
+	/* Read the header block that keeps the HT_info */
+    BF_BlockStorage first_storage;
+    BF_Block *first_block = BF_Block_InitIn(&first_storage);
+	if (BF_GetBlock(fileDesc, 0, first_block) != BF_OK){
+        BF_CloseFile(fileDesc);
+        return -1;
+    }
+
+    /* The descriptor stored in the header belongs to the run that created
+       the file. Only the copy is used, the header block does not change */
+    HT_info info = *(HT_info *)BF_Block_GetData(first_block);
+    info.fileDesc = fileDesc;
+    info.directory = NULL;
+    info.dirDirty = NULL;
+    int code = dir_load(&info);
+    if (code == 0) {
+        code = info.mode == HT_MODE_LINEAR ? linear_statistics(&info) : static_statistics(&info);
+    }
+    dir_free(&info);
+
+	if (BF_UnpinBlock(first_block) != BF_OK) {
+		code = -1;
 	}
-	BF_Block_Destroy(&first_block);
-    BF_CloseFile(fileDesc);
-		
-	return 0;
-}
\ No newline at end of file
+    if (BF_CloseFile(fileDesc) != BF_OK) {
+        code = -1;
+    }
+	return code;
+}
@@ -1,3 +1,4 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,13 +19,107 @@
 
 
 #define BASE (256)
-#define NEXT    BF_BLOCK_SIZE-sizeof(SHT_block_info)
-#define NEXT_HT    BF_BLOCK_SIZE-sizeof(HT_block_info)
-#define MAX_SREC (BF_BLOCK_SIZE-sizeof(SHT_block_info))/sizeof(SHT_record_info)
-#define MAX_REC (BF_BLOCK_SIZE-sizeof(HT_block_info))/sizeof(Record)
+#define NEXT    (BF_GetBlockSize()-sizeof(SHT_block_info))
+#define NEXT_HT    (BF_GetBlockSize()-sizeof(HT_block_info))
+#define MAX_SREC ((BF_GetBlockSize()-sizeof(SHT_block_info))/sizeof(SHT_record_info))
+#define MAX_REC ((BF_GetBlockSize()-sizeof(HT_block_info))/sizeof(Record))
+#define PREFETCH_BLOCKS 16
+#define DIR_ENTRIES (BF_GetBlockSize()/sizeof(SHT_table))   /* directory entries per block */
+
+
+/* The directory of the buckets is a run of dirBlocks blocks from dirFirst,
+   the entry of a bucket is found from its number alone. An open index keeps
+   it in memory, and the blocks of the entries that changed are written back
+   by dir_flush */
+static int dir_get(const SHT_info *sht_info, int bucket, SHT_table *entry){
+    *entry = sht_info->directory[bucket];
+    return 0;
+}
+
+static int dir_set(SHT_info *sht_info, int bucket, const SHT_table *entry){
+    sht_info->directory[bucket] = *entry;
+    sht_info->dirDirty[bucket / DIR_ENTRIES] = 1;
+    return 0;
+}
 
+/* Read the directory of the index into memory */
+static int dir_load(SHT_info *sht_info){
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    sht_info->directory = malloc(sht_info->dirBlocks * DIR_ENTRIES * sizeof(SHT_table));
+    sht_info->dirDirty = calloc(sht_info->dirBlocks, 1);
+    if (sht_info->directory == NULL || sht_info->dirDirty == NULL){
+        return -1;
+    }
+    for (int b = 0; b < sht_info->dirBlocks; b++){
+        if (BF_GetBlock(sht_info->fileDesc, sht_info->dirFirst + b, block) != BF_OK){
+            return -1;
+        }
+        memcpy(sht_info->directory + b * DIR_ENTRIES, BF_Block_GetData(block), DIR_ENTRIES * sizeof(SHT_table));
+        if (BF_UnpinBlock(block) != BF_OK){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Write the directory blocks that changed since the last flush */
+static int dir_flush(SHT_info *sht_info){
+    BF_BlockStorage storage;
+    BF_Block *block = BF_Block_InitIn(&storage);
+    for (int b = 0; b < sht_info->dirBlocks; b++){
+        if (!sht_info->dirDirty[b]){
+            continue;
+        }
+        if (BF_GetBlock(sht_info->fileDesc, sht_info->dirFirst + b, block) != BF_OK){
+            return -1;
+        }
+        memcpy(BF_Block_GetData(block), sht_info->directory + b * DIR_ENTRIES, DIR_ENTRIES * sizeof(SHT_table));
+        BF_Block_SetDirty(block);
+        if (BF_UnpinBlock(block) != BF_OK){
+            return -1;
+        }
+        sht_info->dirDirty[b] = 0;
+    }
+    return 0;
+}
+
+static void dir_free(SHT_info *sht_info){
+    free(sht_info->directory);
+    free(sht_info->dirDirty);
+    sht_info->directory = NULL;
+    sht_info->dirDirty = NULL;
+}
+
+/* Allocate the directory after the header with every entry empty */
+static int dir_allocate(SHT_info *sht_info, int blocks){
+    int first;
+    if (BF_AllocateBlocks(sht_info->fileDesc, blocks, &first, NULL) != BF_OK){
+        return -1;
+    }
+    sht_info->directory = malloc(blocks * DIR_ENTRIES * sizeof(SHT_table));
+    sht_info->dirDirty = malloc(blocks);
+    if (sht_info->directory == NULL || sht_info->dirDirty == NULL){
+        return -1;
+    }
+    for (int i = 0; i < blocks * DIR_ENTRIES; i++){
+        sht_info->directory[i].first = -1;
+        sht_info->directory[i].last = -1;
+    }
+    memset(sht_info->dirDirty, 1, blocks);
+    sht_info->dirFirst = first;
+    sht_info->dirBlocks = blocks;
+    return 0;
+}
 
 int SHT_CreateSecondaryIndex(char *sfileName,  int buckets, char* fileName){
+    return SHT_CreateSecondaryIndexHash(sfileName, buckets, fileName, HT_HASH_MODULO);
+}
+
+int SHT_CreateSecondaryIndexHash(char *sfileName,  int buckets, char* fileName, HT_Hash function){
+    if (buckets < 1 || function < HT_HASH_MODULO || function > HT_HASH_WYHASH) {
+        return -1;
+    }
 	
 	/* Create a file with name filename */ 
     if (BF_CreateFile(sfileName) == BF_ERROR) {
@@ -39,18 +134,13 @@ int SHT_CreateSecondaryIndex(char *sfileName,  int buckets, char* fileName){
     }
 
 
-	/* Allocate the header block that keeps the HP_info */
+	/* Allocate the header block that keeps the HP_info, it comes back pinned */
     BF_Block *first_block;
     BF_Block_Init(&first_block);
     if (BF_AllocateBlock(sfileDesc, first_block) == BF_ERROR){
         return -1;
     }
 
-
-	if (BF_GetBlock(sfileDesc, 0, first_block) == BF_ERROR){
-        return -1;
-    }
-	
     
     /* Read the header block and take the address */
     void *data = BF_Block_GetData(first_block);
@@ -59,17 +149,20 @@ int SHT_CreateSecondaryIndex(char *sfileName,  int buckets, char* fileName){
     SHT_info *sht_info = data;
     sht_info->first_block = first_block;
     sht_info->numBuckets = buckets;
-    sht_info->fileName = malloc(sizeof(char) * strlen(fileName));
+    sht_info->hashFunction = function;
+    sht_info->fileName = malloc(sizeof(char) * (strlen(fileName) + 1));
 	sht_info->fileDesc = sfileDesc;
 	strcpy(sht_info->fileName, fileName);
     
 
-    void* index = data + sizeof(SHT_info);
-    SHT_table * table = index;
-    for(int i=0; i<buckets; i++) {
-        table = index + i*sizeof(SHT_table);
-        table->first = -1;
-        table->last = -1;
+    /* The directory follows the header, as many blocks as the buckets need */
+    int code = dir_allocate(sht_info, (buckets + DIR_ENTRIES - 1) / DIR_ENTRIES);
+    if (code == 0){
+        code = dir_flush(sht_info);
+    }
+    dir_free(sht_info);
+    if (code == -1){
+        return -1;
     }
     
 
@@ -79,31 +172,34 @@ int SHT_CreateSecondaryIndex(char *sfileName,  int buckets, char* fileName){
 		return -1;
 	}
 	BF_Block_Destroy(&first_block);
-    BF_CloseFile(sfileDesc);
+    if (BF_CloseFile(sfileDesc) != BF_OK) {
+        return -1;
+    }
 
 
 	return 0;
 }
 
 SHT_info* SHT_OpenSecondaryIndex(char *indexName){
+    return SHT_OpenSecondaryIndexMode(indexName, BF_OPEN_BUFFERED);
+}
 
-    /* Get the file identifier with BF_OpenFile */
+SHT_info* SHT_OpenSecondaryIndexMode(char *indexName, BF_OpenMode mode){
+
+    /* Get the file identifier with BF_OpenFileMode */
     int fileDesc;
-    if (BF_OpenFile(indexName, &fileDesc)== BF_ERROR){
+    if (BF_OpenFileMode(indexName, &fileDesc, mode) != BF_OK){
        
         return NULL;
     }
 
 
-    /*Read the header_block*/
+    /*Read the header_block, it stays pinned until SHT_CloseSecondaryIndex*/
     BF_Block *block;
     BF_Block_Init(&block);
-    if (BF_AllocateBlock(fileDesc, block) == BF_ERROR){
-        return NULL;
-    }
-
-
-    if (BF_GetBlock(fileDesc,0, block) == BF_ERROR){
+    if (BF_GetBlock(fileDesc,0, block) != BF_OK){
+        BF_Block_Destroy(&block);
+        BF_CloseFile(fileDesc);
         return NULL;
     }
 
@@ -117,13 +213,40 @@ SHT_info* SHT_OpenSecondaryIndex(char *indexName){
 
     memcpy(info, header_info, sizeof(SHT_info));
 
+    /* The descriptor and the handle stored in the header belong to the run that created the file */
+    info->fileDesc = fileDesc;
+    info->first_block = block;
+
+    /* The directory is read once, the operations use the copy in memory */
+    if (dir_load(info) == -1){
+        dir_free(info);
+        BF_UnpinBlock(block);
+        BF_Block_Destroy(&block);
+        BF_CloseFile(fileDesc);
+        free(info);
+        return NULL;
+    }
 
     return info ;
 }
 
 
+int SHT_Checkpoint(SHT_info* sht_info){
+    return dir_flush(sht_info);
+}
+
+
 int SHT_CloseSecondaryIndex( SHT_info* SHT_info ){
 
+    if (SHT_Checkpoint(SHT_info) == -1){
+        return -1;
+    }
+    dir_free(SHT_info);
+
+    /* The header block was pinned by SHT_OpenSecondaryIndex, the file does not close with a pinned block */
+    if (BF_UnpinBlock(SHT_info->first_block) == BF_ERROR){
+        return -1;
+    }
     BF_Block_Destroy(&SHT_info->first_block);
     if (BF_CloseFile(SHT_info->fileDesc)== BF_ERROR){
         BF_PrintError(BF_CloseFile(SHT_info->fileDesc));
@@ -155,42 +278,84 @@ int shash(long int nbuckets, char *key) {
 }
 
 
+static const char *hash_names[] = {"modulo", "fibonacci", "wyhash"};
+
+/* The 64x64 to 128 bit multiply of wyhash, folded back to 64 bits */
+static uint64_t wymix(uint64_t a, uint64_t b){
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+/* The name read 8 characters at a time, one multiply for each word
+   instead of a division for each character */
+static uint64_t wyhash(const char *key, size_t length){
+    const uint64_t p0 = 0xa0761d6478bd642full, p1 = 0xe7037ed1a0b428dbull, p2 = 0x8ebc6af09c88c6e3ull;
+    uint64_t h = p0 ^ length;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8){
+        uint64_t word;
+        memcpy(&word, key + i, 8);
+        h = wymix(word ^ p1, h ^ p2);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, key + i, length - i);
+    return wymix(wymix(tail ^ p1, h ^ p2), length ^ p1);
+}
+
+/* FNV-1a over the characters, spread by a multiply with 2^64/phi */
+static uint64_t fibonacci_hash(const char *key){
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (const unsigned char *k = (const unsigned char *)key; *k != '\0'; k++){
+        h = (h ^ *k) * 0x100000001b3ull;
+    }
+    return h * 0x9E3779B97F4A7C15ull;
+}
+
+/* The bucket of the name under the hash function of the index */
+static int sht_bucket(const SHT_info *sht_info, char *name){
+    switch (sht_info->hashFunction){
+    case HT_HASH_FIBONACCI:
+        return (uint32_t)(fibonacci_hash(name) >> 32) % (unsigned int)sht_info->numBuckets;
+    case HT_HASH_WYHASH:
+        return (uint32_t)wyhash(name, strlen(name)) % (unsigned int)sht_info->numBuckets;
+    default:
+        return shash(sht_info->numBuckets, name);
+    }
+}
+
+
 int SHT_SecondaryInsertEntry(SHT_info* sht_info, Record record, int block_id) {
     
     /* The returning value initialize as -1 in case the record does not entry */
     int block_counter = -1;
-    int index = shash(sht_info->numBuckets, record.name);
+    int index = sht_bucket(sht_info, record.name);
 
     /* Make the sctruct that consists of the name and the block */
     SHT_record_info srecord;
     srecord.block = block_id;
     strcpy(srecord.name, record.name);
 
-    BF_Block *first_block;
-    BF_Block_Init(&first_block);
-    if (BF_GetBlock(sht_info->fileDesc, 0, first_block) == BF_ERROR){
+    /* The handle lives in sht_info, an insert does not allocate memory */
+    BF_Block *block = BF_Block_InitIn(&sht_info->handle);
+
+    /* Read the entry of the bucket from the directory */
+    SHT_table table_entry;
+    SHT_table *table_index = &table_entry;
+    if (dir_get(sht_info, index, table_index) == -1){
         return -1;
     }
 
-    void *data = BF_Block_GetData(first_block);
-    void* index_table = data + sizeof(SHT_info) + index*sizeof(SHT_table);
-
-    /* Go to the memory space that hash table is saved */
-    SHT_table *table_index = index_table;
-
     /* This variable is in order to check if we have insert the element in the last block or not */
     int full_or_first=0;
 
     /* Check if this index has  any block */
     if (table_index->last != -1) {
         /* So if it does we go in the last one and check if there is any space to insert our record */
-        BF_Block *last_block;
-        BF_Block_Init(&last_block);
-        if (BF_GetBlock(sht_info->fileDesc, table_index->last , last_block) == BF_ERROR){
+        if (BF_GetBlock(sht_info->fileDesc, table_index->last , block) != BF_OK){
             return -1;
         }
 
-        void *data = BF_Block_GetData(last_block);
+        void *data = BF_Block_GetData(block);
         SHT_block_info *last_block_info = data+ NEXT;
 
         /* Check if there is enough space */
@@ -204,41 +369,52 @@ int SHT_SecondaryInsertEntry(SHT_info* sht_info, Record record, int block_id) {
             last_block_info->recordsCounter++;
             block_counter= table_index->last;
             
-            BF_Block_SetDirty(last_block);
-
-            if (BF_UnpinBlock(last_block)== BF_ERROR){
-                return -1;
-            }
+            BF_Block_SetDirty(block);
+        }
+        if (BF_UnpinBlock(block) != BF_OK){
+            return -1;
         }
     }
 
     if(full_or_first==0){
         /* Create a new block and insert this first record */
-        BF_Block *new_block;
-        BF_Block_Init(&new_block);
-        if (BF_AllocateBlock(sht_info->fileDesc, new_block) == BF_ERROR){
-            return -1;
-        }
 
         /* Change the pointer of the last block */
+        /* The data blocks start after the header and the directory */
+        int data_first = sht_info->dirFirst + sht_info->dirBlocks;
         if (table_index->last == -1) {
             /* In oder to avoid having the same block in different indexes */
-            /* Index+1 while block0 is the header block */
-            table_index->last = index + 1;
-            table_index->first = index + 1;
+            table_index->last = data_first + index;
+            table_index->first = data_first + index;
         }
         else {
             /* It depends on the num of buckets to which will be the next block */
             table_index->last += sht_info->numBuckets ;
         }
+        if (dir_set(sht_info, index, table_index) == -1){
+            return -1;
+        }
 
+        /* The block of the bucket may lie past the end of the file. The whole
+           overflow level it belongs to is allocated as one extent, so the next
+           overflow blocks of the other buckets are already in place */
+        int blocks_num;
+        if (BF_GetBlockCounter(sht_info->fileDesc, &blocks_num) != BF_OK){
+            return -1;
+        }
+        if (blocks_num <= table_index->last) {
+            int level_end = data_first + ((table_index->last - data_first) / sht_info->numBuckets + 1) * sht_info->numBuckets;
+            if (BF_AllocateBlocks(sht_info->fileDesc, level_end - blocks_num, NULL, NULL) != BF_OK){
+                return -1;
+            }
+        }
 
-        if (BF_GetBlock(sht_info->fileDesc, table_index->last, new_block) == BF_ERROR){
+        if (BF_GetBlock(sht_info->fileDesc, table_index->last, block) != BF_OK){
             return -1;
         }
 
         /* Create block info for my new block */
-        data = BF_Block_GetData(new_block);
+        void *data = BF_Block_GetData(block);
         SHT_block_info *new_block_info = data+ NEXT;
         new_block_info->recordsCounter=0;
 
@@ -246,8 +422,8 @@ int SHT_SecondaryInsertEntry(SHT_info* sht_info, Record record, int block_id) {
         memcpy(data+sizeof(SHT_record_info)*(new_block_info->recordsCounter), &srecord, sizeof(SHT_record_info));
         new_block_info->recordsCounter++;
 
-        BF_Block_SetDirty(new_block); 
-        if (BF_UnpinBlock(new_block)== BF_ERROR){
+        BF_Block_SetDirty(block); 
+        if (BF_UnpinBlock(block) != BF_OK){
             return -1;
         }
     }
@@ -258,7 +434,7 @@ int SHT_SecondaryInsertEntry(SHT_info* sht_info, Record record, int block_id) {
 int SHT_SecondaryGetAllEntries(HT_info* ht_info, SHT_info* sht_info, char* name){
    
     /* Get from the hash function the right pos our index in order to find the right id */ 
-    int index = shash(sht_info->numBuckets, name);
+    int index = sht_bucket(sht_info, name);
 
     int count = 0;
     int blockID = 0;
@@ -266,27 +442,42 @@ int SHT_SecondaryGetAllEntries(HT_info* ht_info, SHT_info* sht_info, char* name)
     /* In case the id does not exist */
     int block_counter = -1;
     
-    /* Get the block ID of first block of records */
-    BF_Block *current_block ;
-    BF_Block_Init(&current_block);
-    if (BF_GetBlock(sht_info->fileDesc, 0, current_block) == BF_ERROR){
+    /* Get the block ID of first block of records from the directory */
+    SHT_table table_index;
+    if (dir_get(sht_info, index, &table_index) == -1){
         return -1;
     }
+    blockID = table_index.first;
+    int last = table_index.last;
 
-    /* Go to the part of block that is stored our hash table */
-    void *data = BF_Block_GetData(current_block);
-    void* new_data = data + sizeof(SHT_info) + index*sizeof(SHT_table);
-    SHT_table *table_index = new_data;
-   
+    /* A bucket that never got a name has no blocks */
+    if (blockID == -1){
+        return -1;
+    }
+
+    /* The handles live on the stack */
+    BF_BlockStorage current_storage, record_storage;
+    BF_Block *current_block = BF_Block_InitIn(&current_storage);
+    BF_Block *record_block = BF_Block_InitIn(&record_storage);
     SHT_block_info *current_block_info;
-    blockID = table_index->first;
+    void *data;
 
     /* Go through the blocks of our hash index position */
-    while(blockID <=table_index->last) {
+    while(blockID <= last) {
         /* Count the number of blocks */
         count++;
 
-        if (BF_GetBlock(sht_info->fileDesc, blockID, current_block) == BF_ERROR){
+        /* The rest of the chain is known, ask for it before we need it */
+        if ((count - 1) % PREFETCH_BLOCKS == 0){
+            int prefetch[PREFETCH_BLOCKS];
+            int n = 0;
+            for (int b = blockID; b <= last && n < PREFETCH_BLOCKS; b += sht_info->numBuckets){
+                prefetch[n++] = b;
+            }
+            BF_Prefetch(sht_info->fileDesc, prefetch, n);
+        }
+
+        if (BF_GetBlock(sht_info->fileDesc, blockID, current_block) != BF_OK){
             return -1;
         }
 
@@ -303,9 +494,8 @@ int SHT_SecondaryGetAllEntries(HT_info* ht_info, SHT_info* sht_info, char* name)
             if(strcmp(current_srec->name , name) == 0){
                 
                 /* Get the block ID of this name srecord */
-                BF_Block *record_block ;
-                BF_Block_Init(&record_block);
-                if (BF_GetBlock(ht_info->fileDesc, current_srec->block, record_block) == BF_ERROR){
+                if (BF_GetBlock(ht_info->fileDesc, current_srec->block, record_block) != BF_OK){
+                    BF_UnpinBlock(current_block);
                     return -1;
                 }
 
@@ -321,70 +511,57 @@ int SHT_SecondaryGetAllEntries(HT_info* ht_info, SHT_info* sht_info, char* name)
                         printRecord(*rec);
                     }
                 }
+                if (BF_UnpinBlock(record_block) != BF_OK){
+                    BF_UnpinBlock(current_block);
+                    return -1;
+                }
                 block_counter=count;
             }
         }
 
+        if (BF_UnpinBlock(current_block) != BF_OK){
+            return -1;
+        }
+
         /* Go to the next block if this index */
         blockID += sht_info->numBuckets ;
     }
-
-    BF_Block_SetDirty(current_block); 
-    if (BF_UnpinBlock(current_block)== BF_ERROR){
-        return -1;
-    }
     
     return count;
 }
 
-int SHashStatistics(char* sfileName){
-    
-	/* Open the file with name filename */
-    int sfileDesc;
-    if (BF_OpenFile(sfileName, &sfileDesc) == BF_ERROR) {
-        return -1;
-    }
-   
-
-	/* Allocate the header block that keeps the HP_info */
-    BF_Block *first_block;
-    BF_Block_Init(&first_block);
-    if (BF_AllocateBlock(sfileDesc, first_block) == BF_ERROR){
-        return -1;
-    }
-
-
-	if (BF_GetBlock(sfileDesc, 0, first_block) == BF_ERROR){
-        return -1;
-    }
-
-	/* Read the header block and take the address */
-    void *data = BF_Block_GetData(first_block);
+/* The statistics of the index, whose chains are every numBuckets blocks */
+static int index_statistics(const SHT_info *sht_info){
+    int sfileDesc = sht_info->fileDesc;
+    SHT_table table_entry;
+    SHT_table * table = &table_entry;
+    int  blockSum = 1 + sht_info->dirBlocks;
 
-
-    /* Store ht_info at the beginning of first block */ 
-    SHT_info *sht_info = data;
-    
-    void* index = data + sizeof(SHT_info);
-    SHT_table * table = index;
-    int  blockSum = 1;
-
-    BF_Block *current_block ;
-    BF_Block_Init(&current_block);
+    /* The handle lives on the stack */
+    BF_BlockStorage current_storage;
+    BF_Block *current_block = BF_Block_InitIn(&current_storage);
     SHT_block_info *current_block_info;
     int* rec_count = malloc(sht_info->numBuckets*sizeof(int));
+    int* overflow = malloc(sht_info->numBuckets*sizeof(int));
+    if (rec_count == NULL || overflow == NULL){
+        free(rec_count);
+        free(overflow);
+        return -1;
+    }
 
     int max = 0;
     int min = 10000;
-    double avg;
     int rec_sum = 0;
 
     int block_overflow=0;
-    int* overflow = malloc(sht_info->numBuckets*sizeof(int));
 
     for(int i=0; i< sht_info->numBuckets; i++) {
         
-        table = index + i*sizeof(SHT_table);
+        if (dir_get(sht_info, i, table) == -1){
+            free(rec_count);
+            free(overflow);
+            return -1;
+        }
         int first = table->first;
         int last = table->last;
         
@@ -406,13 +583,19 @@ int SHashStatistics(char* sfileName){
                 overflow[i] = bucket_blocks-1;
             }
 
-            if (BF_GetBlock(sht_info->fileDesc, last, current_block) == BF_ERROR){
+            /* Only the last block of the chain is not full */
+            if (BF_GetBlock(sfileDesc, last, current_block) != BF_OK){
+                free(rec_count);
+                free(overflow);
                 return -1;
             }
-
-            data = BF_Block_GetData(current_block);
-            current_block_info = data + NEXT ;
+            current_block_info = (void *)BF_Block_GetData(current_block) + NEXT;
             rec_count[i] += current_block_info->recordsCounter;
+            if (BF_UnpinBlock(current_block) != BF_OK){
+                free(rec_count);
+                free(overflow);
+                return -1;
+            }
         }
         else {
             rec_count[i] = 0;
@@ -433,7 +616,7 @@ int SHashStatistics(char* sfileName){
     printf("                     Secondary Hash Table Statistics                      \n");
     printf("                \n");
 
-    printf("MAX REC %ld",MAX_SREC);
+    printf("MAX REC %ld\n",MAX_SREC);
     printf("the number of blocks in this file is : %d\n",blockSum);
     printf("the average number of blocks in every bucket : %d\n",blockSum/sht_info->numBuckets);
     printf("max record sum = %d\n", max);
@@ -441,19 +624,72 @@ int SHashStatistics(char* sfileName){
     printf("avg record sum = %d\n", rec_sum/sht_info->numBuckets);
     printf("%d blocks overflow\n",block_overflow);
 
+    /* How far the records per bucket are from rec_sum/numBuckets in every
+       bucket. Divided by numBuckets - 1, the chi-square is about 1 for a
+       function that spreads the names like a random one */
+    printf("hash function: %s\n", hash_names[sht_info->hashFunction]);
+    if (rec_sum > 0 && sht_info->numBuckets > 1){
+        double squares = 0;
+        for(int i=0; i< sht_info->numBuckets; i++){
+            squares += (double)rec_count[i] * rec_count[i];
+        }
+        double chi_square = sht_info->numBuckets * squares / rec_sum - rec_sum;
+        printf("chi-square %.1f over %d buckets, %.2f per degree of freedom\n",
+               chi_square, sht_info->numBuckets, chi_square / (sht_info->numBuckets - 1));
+        printf("max/mean records per bucket %.2f\n", max / ((double)rec_sum / sht_info->numBuckets));
+    }
+
     for(int i=0; i< sht_info->numBuckets; i++){
         printf("bucket[%d] has %d overflow blocks\n", i, overflow[i]);
     }
+
+    /* What the file has cost the buffer pool so far */
+    BF_Stats stats;
+    if (BF_GetStats(sfileDesc, &stats) == BF_OK) {
+        printf("buffer pool: %ld gets, %ld hits, %ld reads, %ld evictions, %ld dirty writes, %ld pinned\n",
+               stats.gets, stats.hits, stats.reads, stats.evictions, stats.writes, stats.pins);
+        printf("buffer pool: %ld bytes read, %ld bytes written\n", stats.bytes_read, stats.bytes_written);
+    }
     printf("-----------------------------------------------------------------\n");
+    free(rec_count);
+    free(overflow);
+    return 0;
+}
 
-    
-    /* Because we changed the (initially empty) data of the first block */
-    BF_Block_SetDirty(first_block); 
-	if (BF_UnpinBlock(first_block)== BF_ERROR) {
-		return -1;
+int SHashStatistics(char* sfileName){
+
+	/* Open the file with name filename */
+    int sfileDesc;
+    if (BF_OpenFile(sfileName, &sfileDesc) != BF_OK) {
+        return -1;
+    }
+
+
+	/* Read the header block that keeps the SHT_info */
+    BF_BlockStorage first_storage;
+    BF_Block *first_block = BF_Block_InitIn(&first_storage);
+	if (BF_GetBlock(sfileDesc, 0, first_block) != BF_OK){
+        BF_CloseFile(sfileDesc);
+        return -1;
+    }
+
+    /* The descriptor stored in the header belongs to the run that created
+       the file. Only the copy is used, the header block does not change */
+    SHT_info info = *(SHT_info *)BF_Block_GetData(first_block);
+    info.fileDesc = sfileDesc;
+    info.directory = NULL;
+    info.dirDirty = NULL;
+    int code = dir_load(&info);
+    if (code == 0) {
+        code = index_statistics(&info);
+    }
+    dir_free(&info);
+
+	if (BF_UnpinBlock(first_block) != BF_OK) {
+		code = -1;
 	}
-	BF_Block_Destroy(&first_block);
-    BF_CloseFile(sfileDesc);
-		
-	return 0;
+    if (BF_CloseFile(sfileDesc) != BF_OK) {
+        code = -1;
+    }
+	return code;
 }